@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+#
+# Compare the time spent regridding with and without narrow-band regridding
+# (amr.regrid.band). The same input is run once with the band off and once
+# with it on, and the "Regrids: ..." summary printed by alamo at the end of
+# each run is collected.
+#
+# usage:   [alamo]$> scripts/regridtiming.py
+#          [alamo]$> scripts/regridtiming.py --exe bin/alamo-3d-g++ --input tests/Voronoi/input amr.max_level=2
+#
+import argparse
+import subprocess
+import re
+import time
+
+parser = argparse.ArgumentParser(description='Time regridding with and without amr.regrid.band')
+parser.add_argument('args', default=[], nargs='*', help='Extra arguments passed to alamo')
+parser.add_argument('--exe',default='./bin/alamo-2d-g++',help='alamo executable [./bin/alamo-2d-g++]')
+parser.add_argument('--input',default='tests/Voronoi/input',help='Input file [tests/Voronoi/input]')
+parser.add_argument('--band',default=8,type=int,help='amr.regrid.band for the narrow-band run [8]')
+parser.add_argument('--margin',default=2,type=int,help='amr.regrid.margin for the narrow-band run [2]')
+parser.add_argument('--nprocs',default=1,type=int,help='Number of MPI processes [1]')
+parser.add_argument('--output',default='tests/Voronoi/output_regridtiming',help='Prefix for the plot files')
+args=parser.parse_args()
+
+summary = re.compile(r"Regrids: (\d+) performed, (\d+) skipped, ([-+0-9.eE]+) s total")
+
+def run(name, extra):
+    command = []
+    if args.nprocs > 1: command += ["mpirun","-np",str(args.nprocs)]
+    command += [args.exe, args.input, "plot_file={}_{}".format(args.output,name)] + args.args + extra
+    print(' '.join(command))
+    start = time.time()
+    out = subprocess.check_output(command, stderr=subprocess.STDOUT).decode('ascii', 'replace')
+    total = time.time() - start
+    match = summary.findall(out)
+    if not match: raise(Exception("No regrid summary in the output of {}".format(name)))
+    regrids, skipped, regridtime = match[-1]
+    return int(regrids), int(skipped), float(regridtime), total
+
+results = [("full",)       + run("full",["amr.regrid.band=0"]),
+           ("narrowband",) + run("narrowband",["amr.regrid.band={}".format(args.band),
+                                               "amr.regrid.margin={}".format(args.margin)])]
+
+print("")
+print("{:<12}{:>10}{:>10}{:>14}{:>14}".format("run","regrids","skipped","regrid [s]","total [s]"))
+for name, regrids, skipped, regridtime, total in results:
+    print("{:<12}{:>10}{:>10}{:>14.3f}{:>14.3f}".format(name, regrids, skipped, regridtime, total))
+full, band = results[0][3], results[1][3]
+if full > 0: print("regrid time saved: {:.3f} s ({:.1f}%)".format(full-band, 100.0*(full-band)/full))
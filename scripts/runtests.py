@@ -58,6 +58,7 @@ def test(testdir):
     alamo input file:    ./tests/MyTest/input    # Input file with config file comments 
     output file:         ./tests/MyTest/output   # All alamo output
     check script:        ./tests/test            # Executable script that returns 0 for successful test
+                                                 # (the alamo executable is in $ALAMO_EXE)
     
     """
 
@@ -117,6 +118,7 @@ def test(testdir):
         # 2. with 'dim', 'nprocs', 'args', etc keywords. See current tests for
         #    examples
         command = ""
+        exe = None
         if 'cmd' in config[desc].keys():
             command = config[desc]['cmd']
             if len(config[desc].keys()) > 1:
@@ -195,7 +197,10 @@ def test(testdir):
                     cmd.append(config[desc]['check-file'])
                 if args.cmd: 
                     print("  ├      " + ' '.join(cmd))
-                p = subprocess.check_output(cmd,cwd=testdir,stderr=subprocess.PIPE)
+                # Check scripts that run alamo again use the same executable
+                env = dict(os.environ)
+                if exe: env["ALAMO_EXE"] = os.path.abspath(exe)
+                p = subprocess.check_output(cmd,cwd=testdir,stderr=subprocess.PIPE,env=env)
                 checks += 1
             except subprocess.CalledProcessError as e:
                 print("[{}FAIL{}]".format(color.red,color.reset))
@@ -170,6 +170,42 @@ Constant::FillBoundary (amrex::FArrayBox &a_in,
     });
 }
 
+const amrex::Array<amrex::Array<amrex::LinOpBCType,AMREX_SPACEDIM>,2>
+Constant::GetLinOpBCTypes()
+{
+    auto linop = [&](int face) {
+        int bctype = m_bc_type[face][0];
+        if (BCUtil::IsPeriodic(bctype))    return amrex::LinOpBCType::Periodic;
+        if (BCUtil::IsDirichlet(bctype))   return amrex::LinOpBCType::Dirichlet;
+        if (BCUtil::IsReflectOdd(bctype))  return amrex::LinOpBCType::reflect_odd;
+        if (BCUtil::IsNeumann(bctype) || BCUtil::IsReflectEven(bctype))
+        {
+            // MLMG reads Neumann data as a flux, which is not what FillBoundary puts in the ghost cells
+            if (m_bc_val[face].size() > 0 && m_bc_val[face][0](0.0) != 0.0)
+                Util::Abort(INFO,"Inhomogeneous Neumann conditions are not supported by the linear solver");
+            return amrex::LinOpBCType::Neumann;
+        }
+        Util::Abort(INFO,"Boundary type ",bctype," has no linear solver equivalent");
+        return amrex::LinOpBCType::bogus;
+    };
+    return {{{AMREX_D_DECL(linop(Face::XLO),linop(Face::YLO),linop(Face::ZLO))},
+             {AMREX_D_DECL(linop(Face::XHI),linop(Face::YHI),linop(Face::ZHI))}}};
+}
+
+bool
+Constant::IsHomogeneousNeumann() const
+{
+    for (int face = 0; face < m_nfaces; face++)
+        for (unsigned int n = 0; n < m_bc_type[face].size(); n++)
+        {
+            int bctype = m_bc_type[face][n];
+            if (BCUtil::IsPeriodic(bctype)) continue;
+            if (!BCUtil::IsNeumann(bctype)) return false;
+            if (m_bc_val[face].size() > n && m_bc_val[face][n](0.0) != 0.0) return false;
+        }
+    return true;
+}
+
 amrex::BCRec
 Constant::GetBCRec() 
 {
@@ -13,6 +13,18 @@ unsigned long hash = 0;
 std::chrono::time_point<std::chrono::system_clock> starttime_cr;
 std::time_t starttime = 0;
 int percent = -1;
+std::map<std::string,std::string> statistics;
+std::map<std::string,long> accumulated;
+
+void SetMetaData(std::string key, std::string value)
+{
+    statistics[key] = value;
+}
+
+void AccumulateMetaData(std::string key, long increment)
+{
+    accumulated[key] += increment;
+}
 
 void WriteMetaData(std::string plot_file, Status status, int per) 
 {
@@ -88,6 +100,15 @@ void WriteMetaData(std::string plot_file, Status status, int per)
             auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now_cr - starttime_cr);
             metadatafile << "Simulation_run_time = " << (float)milliseconds.count()/1000.0 << " " << std::endl;
 
+            if (statistics.size() || accumulated.size())
+            {
+                metadatafile << std::endl;
+                metadatafile << "# RUN STATISTICS" << std::endl;
+                metadatafile << "# ==============" << std::endl;
+                for (auto &stat : accumulated) metadatafile << stat.first << " = " << stat.second << std::endl;
+                for (auto &stat : statistics)  metadatafile << stat.first << " = " << stat.second << std::endl;
+            }
+
             #ifdef GIT_DIFF_OUTPUT
             {
                 std::ifstream src(GIT_DIFF_OUTPUT,std::ios::binary);
@@ -1,80 +1,180 @@
-#include <AMReX_MLPoisson.H>
+#include <AMReX_MLABecLaplacian.H>
 
 #include "CahnHilliard.H"
 #include "BC/Nothing.H"
+#include "IO/ParmParse.H"
 #include "Numeric/Stencil.H"
 
 namespace Integrator
 {
 CahnHilliard::CahnHilliard() : Integrator()
 {
+    {
+        IO::ParmParse pp("ch");
+        pp.query("gamma", gamma);                 // Gradient energy coefficient
+        std::string method = "explicit";
+        pp.query("method", method);               // Time integration (explicit, implicit)
+        if (method == "explicit") implicit = false;
+        else if (method == "implicit") implicit = true;
+        else Util::Abort(INFO,"Invalid ch.method: ", method);
+        pp.query("stabilization", stabilization); // Linear stabilization S for the implicit method (1.0; raised to 2 sqrt(gamma/dt) if smaller)
+        pp.query("ref_threshold", ref_threshold); // Refine where |grad eta| times the cell diagonal exceeds this (0.1)
+        solver.setTolRel(1E-10);
+        solver.setTolAbs(0.0);
+        pp.queryclass("solver", solver);          // Multigrid settings for the implicit method
+    }
+
     bc = new BC::Nothing();
     ic = new IC::Random(geom,2.0);
     RegisterNewFab(etanewmf, bc, ncomp, nghost, "Eta",true);
     RegisterNewFab(etaoldmf, bc, ncomp, nghost, "EtaOld",false);
     RegisterNewFab(intermediate, bc, ncomp, nghost, "int",false);
-    LPInfo info;
-    op.define(geom,grids,dmap,*bc,info);
-}
 
-
-void
-CahnHilliard::TimeStepBegin(amrex::Real /*time*/, int /*iter*/)
-{
-    // amrex::MLPoisson myop(geom,grids,dmap);
-    // amrex::MLMG solver(myop);
-    // solver.setMaxIter(elastic.max_iter);
-    // solver.setMaxFmgIter(elastic.max_fmg_iter);
-    // solver.setVerbose(elastic.verbose);
-    // solver.setCGVerbose(elastic.cgverbose);
-
-    // etanewmf[0]->setVal(0.0);
-    // etanewmf[0]->setVal(0.0);
-
-    // Set::Scalar tol_rel = 1E-8;
-    // Set::Scalar tol_abs = 0.0;
-    // solver.solve(GetVecOfPtrs(etanewmf),
-    //       GetVecOfConstPtrs(etaoldmf),
-    //       tol_rel,
-    //       tol_abs);
-    
+    RegisterIntegratedVariable(&mass, "mass");
+    RegisterIntegratedVariable(&energy, "energy");
 }
 
 void
 CahnHilliard::Advance (int lev, Set::Scalar /*time*/, Set::Scalar dt)
 {
+    BL_PROFILE("CahnHilliard::Advance");
+    if (implicit)
+    {
+        // All levels are solved at once
+        if (lev == 0) AdvanceImplicit(dt);
+        return;
+    }
+
     std::swap(etaoldmf[lev], etanewmf[lev]);
     const amrex::Real* DX = geom[lev].CellSize();
+
+    // Chemical potential. It must be complete (including ghost cells) before its
+    // Laplacian is taken.
     for ( amrex::MFIter mfi(*etanewmf[lev],true); mfi.isValid(); ++mfi )
     {
         const amrex::Box& bx = mfi.tilebox();
         amrex::Array4<const amrex::Real> const& eta = etaoldmf[lev]->array(mfi);
-        amrex::Array4<amrex::Real> const& inter    = intermediate[lev]->array(mfi);
-        amrex::Array4<amrex::Real> const& etanew    = etanewmf[lev]->array(mfi);
-
+        amrex::Array4<amrex::Real> const& mu        = intermediate[lev]->array(mfi);
         amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k){
-                                    Set::Scalar lap =
-                                        Numeric::Stencil<Set::Scalar,2,0,0>::D(eta,i,j,k,0,DX) +
-                                        Numeric::Stencil<Set::Scalar,2,0,0>::D(eta,i,j,k,0,DX);
+                                    mu(i,j,k) = eta(i,j,k)*eta(i,j,k)*eta(i,j,k) - eta(i,j,k)
+                                                - gamma*Numeric::Laplacian(eta,i,j,k,0,DX);
+                                });
+    }
+    intermediate[lev]->FillBoundary(geom[lev].periodicity());
 
-                                    inter(i,j,k) =
-                                        eta(i,j,k)*eta(i,j,k)*eta(i,j,k)
-                                        - eta(i,j,k)
-                                        - gamma*lap;
+    for ( amrex::MFIter mfi(*etanewmf[lev],true); mfi.isValid(); ++mfi )
+    {
+        const amrex::Box& bx = mfi.tilebox();
+        amrex::Array4<const amrex::Real> const& eta = etaoldmf[lev]->array(mfi);
+        amrex::Array4<const amrex::Real> const& mu  = intermediate[lev]->const_array(mfi);
+        amrex::Array4<amrex::Real> const& etanew    = etanewmf[lev]->array(mfi);
+        amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k){
+                                    etanew(i,j,k) = eta(i,j,k) + dt*Numeric::Laplacian(mu,i,j,k,0,DX);
+                                });
+    }
+    etanewmf[lev]->FillBoundary(geom[lev].periodicity());
+}
 
+void
+CahnHilliard::AdvanceImplicit (Set::Scalar dt)
+{
+    BL_PROFILE("CahnHilliard::AdvanceImplicit");
+    const int nlevels = finest_level + 1;
 
-                                    etanew(i,j,k) = eta(i,j,k) - dt*inter(i,j,k); // Allen Cahn
-                                });
+    // The factorization (I - a Lap)(I - b Lap) has real roots only if S^2 dt >= 4 gamma
+    const Set::Scalar S = std::max(stabilization, 2.0*std::sqrt(gamma/dt));
+    if (S > stabilization && !stabilization_warned)
+    {
+        Util::Warning(INFO,"ch.stabilization = ",stabilization," is raised to ",S," for dt = ",dt);
+        stabilization_warned = true;
+    }
+    const Set::Scalar disc = std::sqrt(std::max(0.0, S*S*dt*dt - 4.0*gamma*dt));
+    const Set::Scalar a = 0.5*(S*dt + disc), b = 0.5*(S*dt - disc);
 
-        amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k){
-                                    Set::Scalar lap = 
-                                        Numeric::Stencil<Set::Scalar,2,0,0>::D(inter,i,j,k,0,DX) +
-                                        Numeric::Stencil<Set::Scalar,2,0,0>::D(inter,i,j,k,0,DX);
+    amrex::Vector<amrex::Geometry> a_geom(nlevels);
+    amrex::Vector<amrex::BoxArray> a_grids(nlevels);
+    amrex::Vector<amrex::DistributionMapping> a_dmap(nlevels);
+    for (int lev = 0; lev < nlevels; lev++)
+    {
+        a_geom[lev] = geom[lev]; a_grids[lev] = grids[lev]; a_dmap[lev] = dmap[lev];
+        std::swap(etaoldmf[lev], etanewmf[lev]);
+    }
 
-                                    etanew(i,j,k) = eta(i,j,k) + dt*lap;
-                                });
+    amrex::Array<amrex::LinOpBCType,AMREX_SPACEDIM> bctype;
+    for (int d = 0; d < AMREX_SPACEDIM; d++)
+        bctype[d] = geom[0].isPeriodic(d) ? amrex::LinOpBCType::Periodic : amrex::LinOpBCType::Neumann;
+
+    // Each operator is (alpha I - beta Lap); ghost cells are handled by MLMG
+    // so the fields do not need to be filled beforehand.
+    auto helmholtz = [&](Set::Scalar alpha, Set::Scalar beta) {
+        std::unique_ptr<amrex::MLABecLaplacian> op(new amrex::MLABecLaplacian(a_geom, a_grids, a_dmap));
+        op->setMaxOrder(2);
+        op->setDomainBC(bctype, bctype);
+        op->setScalars(alpha, beta);
+        for (int lev = 0; lev < nlevels; lev++)
+        {
+            op->setLevelBC(lev, nullptr);
+            amrex::MultiFab acoef(grids[lev], dmap[lev], 1, 0);
+            acoef.setVal(1.0);
+            op->setACoeffs(lev, acoef);
+            amrex::Array<amrex::MultiFab, AMREX_SPACEDIM> bcoef;
+            for (int d = 0; d < AMREX_SPACEDIM; d++)
+            {
+                bcoef[d].define(amrex::convert(grids[lev], amrex::IntVect::TheDimensionVector(d)), dmap[lev], 1, 0);
+                bcoef[d].setVal(1.0);
+            }
+            op->setBCoeffs(lev, amrex::GetArrOfConstPtrs(bcoef));
+        }
+        return op;
+    };
+
+    Set::Field<Set::Scalar> g, lapg, w;
+    g.Define(nlevels, a_grids, a_dmap, ncomp, nghost);
+    lapg.Define(nlevels, a_grids, a_dmap, ncomp, 0);
+    w.Define(nlevels, a_grids, a_dmap, ncomp, nghost);
+
+    // g = f'(eta^n) - S eta^n
+    for (int lev = 0; lev < nlevels; lev++)
+        for ( amrex::MFIter mfi(*g[lev],true); mfi.isValid(); ++mfi )
+        {
+            const amrex::Box& bx = mfi.tilebox();
+            amrex::Array4<const amrex::Real> const& eta = etaoldmf[lev]->array(mfi);
+            amrex::Array4<amrex::Real> const& gg        = g[lev]->array(mfi);
+            amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k){
+                                        gg(i,j,k) = eta(i,j,k)*eta(i,j,k)*eta(i,j,k) - eta(i,j,k) - S*eta(i,j,k);
+                                    });
+        }
+
+    // rhs = eta^n + dt Lap g  (stored in lapg)
+    {
+        auto laplacian = helmholtz(0.0, -1.0);
+        solver.Define(*laplacian);
+        solver.apply(lapg, g);
+        solver.Clear();
+    }
+    for (int lev = 0; lev < nlevels; lev++)
+    {
+        amrex::MultiFab::Xpay(*lapg[lev], dt, *etaoldmf[lev], 0, 0, ncomp, 0);
+        amrex::MultiFab::Copy(*w[lev], *etaoldmf[lev], 0, 0, ncomp, 0);
+        amrex::MultiFab::Copy(*etanewmf[lev], *etaoldmf[lev], 0, 0, ncomp, 0);
+    }
 
+    // (I - a Lap) w = rhs, then (I - b Lap) eta^{n+1} = w
+    {
+        auto op = helmholtz(1.0, a);
+        solver.Define(*op);
+        solver.solve(w, lapg);
+        solver.Clear();
     }
+    {
+        auto op = helmholtz(1.0, b);
+        solver.Define(*op);
+        solver.solve(etanewmf, w);
+        solver.Clear();
+    }
+
+    for (int lev = 0; lev < nlevels; lev++)
+        etanewmf[lev]->FillBoundary(geom[lev].periodicity());
 }
 
 void
@@ -84,13 +184,48 @@ CahnHilliard::Initialize (int lev)
     etaoldmf[lev]->setVal(-1.);
     ic->Add(lev,etanewmf);
     ic->Add(lev,etaoldmf);
+    etanewmf[lev]->FillBoundary(geom[lev].periodicity());
+    etaoldmf[lev]->FillBoundary(geom[lev].periodicity());
 }
 
 
 void
-CahnHilliard::TagCellsForRefinement (int /*lev*/, amrex::TagBoxArray& /*tags*/, amrex::Real /*time*/, int /*ngrow*/)
+CahnHilliard::TagCellsForRefinement (int lev, amrex::TagBoxArray& a_tags, amrex::Real /*time*/, int /*ngrow*/)
 {
+    BL_PROFILE("CahnHilliard::TagCellsForRefinement");
+    const amrex::Real* DX = geom[lev].CellSize();
+    const Set::Scalar dxnorm = Set::Vector(DX).lpNorm<2>();
+    const Set::Scalar threshold = ref_threshold;
+
+    for (amrex::MFIter mfi(*etanewmf[lev], amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        if (!InTagBand(lev, mfi)) continue;
+        const amrex::Box& bx = mfi.tilebox();
+        amrex::Array4<const amrex::Real> const& eta = etanewmf[lev]->const_array(mfi);
+        amrex::Array4<char> const& tags = a_tags.array(mfi);
+        amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k){
+                                    if (dxnorm * Numeric::Gradient(eta,i,j,k,0,DX).lpNorm<2>() > threshold)
+                                        tags(i,j,k) = amrex::TagBox::SET;
+                                });
+    }
 }
 
+void
+CahnHilliard::Integrate(int amrlev, Set::Scalar /*time*/, int /*step*/,
+                        const amrex::MFIter &mfi, const amrex::Box &box, const ThermoSum &sum)
+{
+    BL_PROFILE("CahnHilliard::Integrate");
+    const amrex::Real* DX = geom[amrlev].CellSize();
+    const Set::Scalar dv = AMREX_D_TERM(DX[0],*DX[1],*DX[2]);
+
+    amrex::Array4<const amrex::Real> const& eta = etanewmf[amrlev]->const_array(mfi);
+    auto mass_sum = sum(mass), energy_sum = sum(energy);
+    amrex::ParallelFor(box, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                                mass_sum += eta(i,j,k) * dv;
+                                Set::Vector grad = Numeric::Gradient(eta,i,j,k,0,DX);
+                                Set::Scalar psi = 0.25*(eta(i,j,k)*eta(i,j,k) - 1.0)*(eta(i,j,k)*eta(i,j,k) - 1.0);
+                                energy_sum += (psi + 0.5*gamma*grad.squaredNorm()) * dv;
+                            });
+}
 
 }
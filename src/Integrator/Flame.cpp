@@ -200,10 +200,8 @@ namespace Integrator
                 amrex::Array4<model_type> const &model = elastic.model_mf[lev]->array(mfi);
                 amrex::Array4<Set::Scalar> const &stress = elastic.stress_mf[lev]->array(mfi);
                 amrex::Array4<const Set::Scalar> const &disp = elastic.disp_mf[lev]->array(mfi);
-                amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k)
+                Numeric::ParallelForStencil(bx, bx, [=] AMREX_GPU_DEVICE(int i, int j, int k, auto sten)
                                    {
-                                    std::array<Numeric::StencilType, AMREX_SPACEDIM>
-                                        sten = Numeric::GetStencil(i, j, k, bx);
                                     if (model(i, j, k).kinvar == Model::Solid::KinematicVariable::F)
                                     {
                                         Set::Matrix F = Set::Matrix::Identity() + Numeric::Gradient(disp, i, j, k, DX, sten);
@@ -336,6 +334,7 @@ namespace Integrator
         // Eta criterion for refinement
         for (amrex::MFIter mfi(*Eta_mf[lev], true); mfi.isValid(); ++mfi)
         {
+            if (!InTagBand(lev, mfi)) continue;
             const amrex::Box &bx = mfi.tilebox();
             amrex::Array4<char> const &tags = a_tags.array(mfi);
             amrex::Array4<const Set::Scalar> const &Eta = (*Eta_mf[lev]).array(mfi);
@@ -352,6 +351,7 @@ namespace Integrator
         {
             for (amrex::MFIter mfi(*Temp_mf[lev], true); mfi.isValid(); ++mfi)
             {
+                if (!InTagBand(lev, mfi)) continue;
                 const amrex::Box &bx = mfi.tilebox();
                 amrex::Array4<char> const &tags = a_tags.array(mfi);
                 amrex::Array4<const Set::Scalar> const &Temp = (*Temp_mf[lev]).array(mfi);
@@ -363,6 +363,43 @@ namespace Integrator
             }
         }
     }
+    Set::Scalar Flame::StableTimestep(int lev)
+    {
+        const amrex::Real *DX = geom[lev].CellSize();
+        Set::Scalar dx2 = std::numeric_limits<Set::Scalar>::infinity();
+        for (int d = 0; d < AMREX_SPACEDIM; d++) dx2 = std::min(dx2, DX[d]*DX[d]);
+        Set::Scalar dt = std::numeric_limits<Set::Scalar>::infinity();
+
+        // Forward Euler bound for the phase field (evolved on the finest level only),
+        // using the largest mobility and the largest curvature of the chemical potential
+        if (lev == finest_level && pf.w1 != pf.w0)
+        {
+            Set::Scalar
+                a0 = pf.w0,
+                a2 = -5.0 * pf.w1 + 16.0 * pf.w12 - 11.0 * a0,
+                a3 = 14.0 * pf.w1 - 32.0 * pf.w12 + 18.0 * a0,
+                a4 = -8.0 * pf.w1 + 16.0 * pf.w12 -  8.0 * a0;
+            Set::Scalar fmod_ap   = pf.r_ap * pow(pf.P, pf.n_ap);
+            Set::Scalar fmod_htpb = pf.r_htpb * pow(pf.P, pf.n_htpb);
+            Set::Scalar fmod_comb = pf.r_comb * pow(pf.P, pf.n_comb);
+            Set::Scalar L = (std::max(fmod_ap, fmod_htpb) + fmod_comb) / pf.gamma / std::fabs(pf.w1 - pf.w0);
+            Set::Scalar ddf = 2.0*std::fabs(a2) + 6.0*std::fabs(a3) + 12.0*std::fabs(a4);
+            Set::Scalar rate = L * ((pf.eps > 0.0 ? pf.lambda/pf.eps*ddf : 0.0)
+                                    + 4.0 * AMREX_SPACEDIM * pf.eps * pf.kappa / dx2);
+            if (rate > 0.0) dt = std::min(dt, 2.0 / rate);
+        }
+
+        // Diffusion limit for the temperature with the largest diffusivity
+        if (thermal.on)
+        {
+            Set::Scalar K = std::max({thermal.ka, thermal.kh, thermal.k0});
+            Set::Scalar rhocp = std::min(thermal.cp0, thermal.cp1) * std::min(thermal.rho0, thermal.rho1);
+            if (K > 0.0 && rhocp > 0.0) dt = std::min(dt, dx2 * rhocp / (2.0 * AMREX_SPACEDIM * K));
+        }
+
+        return dt;
+    }
+
     void Flame::Regrid(int lev, Set::Scalar /* time */)
     {
         if (lev < finest_level) return;
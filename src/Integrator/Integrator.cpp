@@ -8,6 +8,9 @@
 #include "IO/ParmParse.H"
 #include "Util/Util.H"
 #include <numeric>
+#include <algorithm>
+#include <sstream>
+#include <AMReX_Reduce.H>
 
 
 
@@ -27,6 +30,9 @@ Integrator::Integrator ()
         pp.query("restart", restart_file_cell);       // Name of restart file to READ from
         pp.query("restart_cell", restart_file_cell);  // Name of cell-fab restart file to read from
         pp.query("restart_node", restart_file_node);  // Name of node-fab restart file to read from
+        pp.query("restart_checkpoint", restart_file_checkpoint); // Name of checkpoint directory to continue from
+        if (restart_file_checkpoint != "" && (restart_file_cell != "" || restart_file_node != ""))
+            Util::Abort(INFO,"restart_checkpoint cannot be combined with restart, restart_cell or restart_node");
     }
     {
         // This allows the user to ignore certain arguments that
@@ -54,6 +60,16 @@ Integrator::Integrator ()
         pp.query("plot_int", plot_int);               // Interval (in timesteps) between plotfiles
         pp.query("plot_dt", plot_dt);                 // Interval (in simulation time) between plotfiles
         pp.query("plot_file", plot_file);             // Output file
+        pp.query("plot_async", plot_async.on);        // Write plotfiles on a background thread (default: off)
+        pp.query("plot_async_max", plot_async.max_pending); // Maximum number of plotfiles waiting to be written (default: 2)
+        pp.query("check_finite_int", check_finite_int); // Interval (in timesteps) between NaN/Inf checks of all fields (default: 0, off; plotfiles only warn)
+        pp.query("checkpoint_int", checkpoint_int);   // Interval (in timesteps) between checkpoints (default: 0, off)
+        if (plot_async.on && !amrex::AsyncOut::UseAsyncOut())
+        {
+            Util::Warning(INFO,"amr.plot_async requires amrex.async_out; writing plotfiles synchronously");
+            plot_async.on = false;
+        }
+        Util::Assert(INFO,TEST(plot_async.max_pending > 0));
         
         pp.query("cell.all",cell.all);                // Turn on to write all output in cell fabs (default: off)
         pp.query("cell.any",cell.any);                // Turn off to prevent any cell based output (default: on)
@@ -93,9 +109,54 @@ Integrator::Integrator ()
         amrex::ParmParse pp("amr.thermo");
         thermo.interval = 1;                           // Default: integrate every time.
         pp.query("int", thermo.interval);              // Integration interval (1)
-        pp.query("plot_int", thermo.plot_int);         // Interval (in timesteps) between writing
+        pp.query("plot_int", thermo.plot_int);         // Interval (in timesteps) between writing (1 if dt.adaptive, otherwise never)
         pp.query("plot_dt", thermo.plot_dt);           // Interval (in simulation time) between writing
     }
+    {
+        // Adaptive timestep control. The nominal timestep is limited by the
+        // integrator's stability estimate and, for integrators that provide an
+        // error estimate, adjusted by a PI controller. Steps whose error exceeds
+        // the tolerance are rejected and retried with a smaller timestep. Steps
+        // are shortened to land exactly on plot_dt output times and stop_time.
+        amrex::ParmParse pp("dt");
+        pp.query("adaptive", dtcontrol.adaptive);     // Turn on adaptive timestepping (default: off)
+        pp.query("min", dtcontrol.min);               // Smallest allowed timestep (0)
+        pp.query("max", dtcontrol.max);               // Largest allowed timestep (unlimited)
+        pp.query("growth", dtcontrol.growth);         // Maximum factor by which the timestep may grow per step (1.2)
+        pp.query("cfl", dtcontrol.cfl);               // Fraction of the stable timestep to use (0.9)
+        pp.query("tolerance", dtcontrol.tolerance);   // Target relative local error for the PI controller (1E-3)
+        pp.query("safety", dtcontrol.safety);         // Safety factor for the PI controller (0.9)
+        pp.query("ki", dtcontrol.ki);                 // Integral gain of the PI controller (0.35)
+        pp.query("kp", dtcontrol.kp);                 // Proportional gain of the PI controller (0.2)
+        pp.query("reject", dtcontrol.reject);         // Retry steps whose error exceeds the tolerance (1; not with general fabs)
+        pp.query("max_rejects", dtcontrol.max_rejects); // Retries of a step before it is accepted anyway (10)
+        Util::Assert(INFO,TEST(dtcontrol.growth >= 1.0));
+        Util::Assert(INFO,TEST(dtcontrol.min <= dtcontrol.max));
+        // Record the timestep history (dt column of thermo.dat) every step
+        // unless thermo output has been set explicitly
+        if (dtcontrol.adaptive && thermo.plot_int <= 0 && thermo.plot_dt <= 0.0) thermo.plot_int = 1;
+    }
+
+    {
+        // Redistribute boxes among ranks by their estimated cost (see EstimateCost)
+        amrex::ParmParse pp("amr.loadbalance");
+        pp.query("int", loadbalance.interval);        // Interval (in timesteps) between load balancing (0, off)
+        pp.query("threshold", loadbalance.threshold); // Redistribute if max/mean rank load exceeds this (1.1)
+        pp.query("strategy", loadbalance.strategy);   // Distribution algorithm: knapsack or sfc (knapsack)
+        if (loadbalance.strategy != "knapsack" && loadbalance.strategy != "sfc")
+            Util::Abort(INFO,"Invalid amr.loadbalance.strategy: ",loadbalance.strategy);
+    }
+    {
+        // Incremental regridding for interface-tracking problems: tags are only
+        // re-evaluated near the previous tags, regrids are skipped while the
+        // tags stay inside the finer grids, and unchanged boxes keep their data.
+        amrex::ParmParse pp("amr.regrid");
+        pp.query("band", narrowband.band);            // Width (in cells) of the band around the previous tags (0, off)
+        pp.query("margin", narrowband.margin);        // Distance (in cells) tags must keep from the edge of the finer grids (n_error_buf/2)
+        narrowband.tags.resize(maxLevel()+1);
+        narrowband.active.resize(maxLevel()+1);
+        narrowband.fresh.resize(maxLevel()+1, 0);
+    }
 
     {
         // Instead of using AMR, prescribe an explicit, user-defined
@@ -143,6 +204,8 @@ Integrator::Integrator ()
 Integrator::~Integrator ()
 {
     BL_PROFILE("Integrator::~Integrator");
+    if (plot_async.on) plot_async.queue->Wait();
+    if (thermo.file.is_open()) thermo.file.close();
     if (amrex::ParallelDescriptor::IOProcessor())
         IO::WriteMetaData(plot_file,IO::Status::Complete);
 }
@@ -156,6 +219,7 @@ void Integrator::SetTimestep(Set::Scalar _timestep)
     dt[0] = timestep;
     for (int i = 1; i < nlevs_max; i++)
         dt[i] = dt[i-1] / (amrex::Real)nsubsteps[i];
+    dtcontrol.nominal = timestep;
 }
 void Integrator::SetPlotInt(int a_plot_int)
 {
@@ -220,32 +284,69 @@ Integrator::RemakeLevel (int lev,       ///<[in] AMR Level
                         const amrex::DistributionMapping& dm)
 {
     BL_PROFILE("Integrator::RemakeLevel");
-    for (int n=0; n < cell.number_of_fabs; n++)
+
+    // With incremental regridding, boxes that are unchanged from the old grids
+    // keep their data and only the new boxes are filled by FillPatch. (Ghost
+    // cells of unchanged boxes at coarse/fine boundaries are refilled before
+    // the next Advance.)
+    amrex::BoxList changed_bl;
+    amrex::Vector<int> changed_pmap;
+    bool incremental = false;
+    if (narrowband.band > 0)
     {
-        const int ncomp  = (*cell.fab_array[n])[lev]->nComp();
-        const int nghost = (*cell.fab_array[n])[lev]->nGrow();
+        for (int i = 0; i < (int)cgrids.size(); i++)
+        {
+            bool unchanged = false;
+            for (auto &isect : grids[lev].intersections(cgrids[i]))
+                if (grids[lev][isect.first] == cgrids[i]) unchanged = true;
+            if (unchanged) continue;
+            changed_bl.push_back(cgrids[i]);
+            changed_pmap.push_back(dm[i]);
+        }
+        incremental = ((int)changed_pmap.size() < (int)cgrids.size());
+        if (Verbose() && incremental)
+            Util::Message(INFO,"Level ",lev,": ",cgrids.size()-changed_pmap.size()," of ",cgrids.size()," boxes unchanged");
+    }
+    amrex::BoxArray changed_ba(changed_bl);
+    amrex::DistributionMapping changed_dm;
+    if (changed_pmap.size()) changed_dm.define(changed_pmap);
 
-        amrex::MultiFab new_state(cgrids, dm, ncomp, nghost); 
+    auto remake = [&](Set::Field<Set::Scalar> &field, BC::BC<Set::Scalar> &physbc, const amrex::BoxArray &ba, const amrex::BoxArray &patch_ba)
+    {
+        const int ncomp  = field[lev]->nComp();
+        const int nghost = field[lev]->nGrow();
 
+        amrex::MultiFab new_state(ba, dm, ncomp, nghost);
         new_state.setVal(0.0);
-        FillPatch(lev, time, *cell.fab_array[n], new_state, *cell.physbc_array[n], 0);
-        std::swap(new_state, *(*cell.fab_array[n])[lev]);
-    }
+        if (!incremental)
+        {
+            FillPatch(lev, time, field, new_state, physbc, 0);
+        }
+        else
+        {
+            new_state.ParallelCopy(*field[lev], 0, 0, ncomp, 0, nghost, geom[lev].periodicity());
+            if (changed_pmap.size())
+            {
+                amrex::MultiFab patch(patch_ba, changed_dm, ncomp, nghost);
+                patch.setVal(0.0);
+                FillPatch(lev, time, field, patch, physbc, 0);
+                new_state.ParallelCopy(patch, 0, 0, ncomp, nghost, nghost, geom[lev].periodicity());
+            }
+            physbc.define(geom[lev]);
+            physbc.FillBoundary(new_state, 0, 0, time, 0);
+        }
+        std::swap(new_state, *field[lev]);
+    };
 
-    amrex::BoxArray ngrids = cgrids;
+    for (int n=0; n < cell.number_of_fabs; n++)
+        remake(*cell.fab_array[n], *cell.physbc_array[n], cgrids, changed_ba);
+
+    amrex::BoxArray ngrids = cgrids, changed_nba = changed_ba;
     ngrids.convert(amrex::IntVect::TheNodeVector());
+    changed_nba.convert(amrex::IntVect::TheNodeVector());
 
     for (int n=0; n < node.number_of_fabs; n++)
-    {
-        const int ncomp  = (*node.fab_array[n])[lev]->nComp();
-        const int nghost = (*node.fab_array[n])[lev]->nGrow();
-
-        amrex::MultiFab new_state(ngrids, dm, ncomp, nghost); 
-
-        new_state.setVal(0.0);
-        FillPatch(lev, time, *node.fab_array[n], new_state, *node.physbc_array[n], 0);
-        std::swap(new_state, *(*node.fab_array[n])[lev]);
-    }
+        remake(*node.fab_array[n], *node.physbc_array[n], ngrids, changed_nba);
 
     for (unsigned int n = 0; n < m_basefields.size(); n++)
     {
@@ -460,11 +561,145 @@ Integrator::FillCoarsePatch (int lev, ///<[in] AMR level
                                 mapper, bcs, 0);
 }
  
+void
+Integrator::regrid (int lbase, Set::Scalar time, bool initial)
+{
+    if (explicitmesh.on) return;
+    BL_PROFILE("Integrator::regrid");
+
+    // Wall time is recorded with and without amr.regrid.band so that the two can be compared
+    const amrex::Real start = amrex::second();
+    if (narrowband.band > 0 && !initial && TagsCovered(lbase, time))
+    {
+        narrowband.skipped++;
+        if (Verbose()) Util::Message(INFO,"Tags are covered by the current grids; skipping regrid");
+    }
+    else
+    {
+        AmrCore::regrid(lbase, time, initial);
+        narrowband.regrids++;
+    }
+    std::fill(narrowband.fresh.begin(), narrowband.fresh.end(), 0);
+    narrowband.time += amrex::second() - start;
+}
+
+//
+// Tag levels lbase and up (ending on the finest level that may be refined)
+// and check whether every tag lies at least `margin` cells inside the grids of
+// the next finer level. Tags on the finest existing level always require a
+// regrid, since a new level has to be made.
+//
+bool
+Integrator::TagsCovered (int lbase, Set::Scalar time)
+{
+    BL_PROFILE("Integrator::TagsCovered");
+    bool covered = true;
+    for (int lev = lbase; covered && lev <= std::min(finest_level, max_level-1); lev++)
+    {
+        amrex::TagBoxArray tags(grids[lev], dmap[lev], 0);
+        tags.setVal(amrex::TagBox::CLEAR);
+        ErrorEst(lev, tags, time, 0);
+        narrowband.fresh[lev] = 1;
+
+        // A tag needs a regrid if it lies within `margin` cells of the part of
+        // the domain that the finer grids do not cover (all of it on the
+        // finest level). Only the intersections with that region are searched.
+        const int margin = narrowband.margin >= 0 ? narrowband.margin : nErrorBuf(lev)/2;
+        const amrex::Box domain = geom[lev].Domain();
+        amrex::BoxList uncovered(domain);
+        if (lev < finest_level)
+        {
+            amrex::BoxArray fine = grids[lev+1];
+            fine.coarsen(refRatio(lev));
+            uncovered = fine.complementIn(domain);
+        }
+        bool ok = true;
+        if (uncovered.isNotEmpty())
+        {
+            uncovered.accrete(margin);
+            const amrex::BoxArray exposed(uncovered);
+            std::vector<std::pair<int,amrex::Box>> isects;
+            for (amrex::MFIter mfi(tags); ok && mfi.isValid(); ++mfi)
+            {
+                amrex::Array4<const char> const &t = tags.const_array(mfi);
+                exposed.intersections(mfi.validbox(), isects);
+                for (const auto &is : isects)
+                    amrex::LoopOnCpu(is.second, [&](int i, int j, int k) {
+                        if (t(i,j,k) == amrex::TagBox::SET) ok = false;
+                    });
+            }
+        }
+        amrex::ParallelDescriptor::ReduceBoolAnd(ok);
+        covered = ok;
+    }
+    return covered;
+}
+
 void
 Integrator::ErrorEst (int lev, amrex::TagBoxArray& tags, amrex::Real time, int ngrow)
 {
     BL_PROFILE("Integrator::ErrorEst");
+    if (narrowband.band <= 0)
+    {
+        TagCellsForRefinement(lev,tags,time,ngrow);
+        return;
+    }
+
+    std::unique_ptr<amrex::iMultiFab> &cache = narrowband.tags[lev];
+
+    // Tags were just evaluated on these grids by TagsCovered
+    if (narrowband.fresh[lev] && cache &&
+        cache->boxArray() == tags.boxArray() && cache->DistributionMap() == tags.DistributionMap())
+    {
+        for (amrex::MFIter mfi(*cache); mfi.isValid(); ++mfi)
+        {
+            amrex::Array4<const int> const &c = cache->const_array(mfi);
+            amrex::Array4<char> const &t = tags.array(mfi);
+            amrex::LoopOnCpu(mfi.validbox(), [&](int i, int j, int k) {
+                if (c(i,j,k)) t(i,j,k) = amrex::TagBox::SET;
+            });
+        }
+        return;
+    }
+
+    // A box is tagged if it is within the band of the previous tags, or if
+    // part of it was not covered by the previous grids on this level.
+    narrowband.active[lev].reset(new amrex::LayoutData<int>(tags.boxArray(), tags.DistributionMap()));
+    amrex::LayoutData<int> &active = *narrowband.active[lev];
+    if (!cache)
+    {
+        for (amrex::MFIter mfi(active); mfi.isValid(); ++mfi) active[mfi] = 1;
+    }
+    else
+    {
+        const int band = narrowband.band;
+        amrex::iMultiFab previous(tags.boxArray(), tags.DistributionMap(), 1, band);
+        previous.setVal(0);
+        previous.ParallelCopy(*cache, 0, 0, 1, 0, band, geom[lev].periodicity());
+        for (amrex::MFIter mfi(previous); mfi.isValid(); ++mfi)
+        {
+            const amrex::Box bx = mfi.validbox();
+            int near = !cache->boxArray().complementIn(bx).isEmpty();
+            amrex::Array4<const int> const &p = previous.const_array(mfi);
+            amrex::LoopOnCpu(amrex::grow(bx, band), [&](int i, int j, int k) {
+                if (p(i,j,k)) near = 1;
+            });
+            active[mfi] = near;
+        }
+    }
+
     TagCellsForRefinement(lev,tags,time,ngrow);
+    narrowband.active[lev].reset();
+
+    cache.reset(new amrex::iMultiFab(tags.boxArray(), tags.DistributionMap(), 1, 0));
+    for (amrex::MFIter mfi(*cache); mfi.isValid(); ++mfi)
+    {
+        amrex::Array4<int> const &c = cache->array(mfi);
+        amrex::Array4<const char> const &t = tags.const_array(mfi);
+        amrex::LoopOnCpu(mfi.validbox(), [&](int i, int j, int k) {
+            c(i,j,k) = (t(i,j,k) == amrex::TagBox::SET);
+        });
+    }
 }
 
 
@@ -473,7 +708,11 @@ Integrator::InitData ()
 {
     BL_PROFILE("Integrator::InitData");
     
-    if (restart_file_cell == "" && restart_file_node == "")
+    if (restart_file_checkpoint != "")
+    {
+        ReadCheckpoint(restart_file_checkpoint);
+    }
+    else if (restart_file_cell == "" && restart_file_node == "")
     {
         const amrex::Real time = 0.0;
         InitFromScratch(time);
@@ -672,6 +911,256 @@ Integrator::Restart(const std::string dirname, bool a_nodal)
     SetFinestLevel(max_level);
 }
 
+//
+// Checkpoints hold everything needed to continue a run exactly: all registered
+// fields (including ghost cells and general fields such as material models),
+// the grids and their distribution, the time and step of every level, the
+// timestep controller, and the random number generator. The Header is text;
+// the field data on each level is written by every rank to its own binary file
+// Level_<lev>/Data_<rank>, in the order cell fabs, node fabs, general fields.
+//
+void
+Integrator::WriteCheckpoint () const
+{
+    BL_PROFILE("Integrator::WriteCheckpoint");
+    const int nlevels = finest_level + 1;
+    const std::string dirname = plot_file + "/" + amrex::Concatenate("", istep[0], 5) + "chk";
+    amrex::PreBuildDirectorHierarchy(dirname, "Level_", nlevels, true);
+
+    if (amrex::ParallelDescriptor::IOProcessor())
+    {
+        std::ofstream os(dirname + "/Header");
+        os.precision(std::numeric_limits<Set::Scalar>::max_digits10);
+        os << "alamo-checkpoint-1\n";
+        os << AMREX_SPACEDIM << " " << amrex::ParallelDescriptor::NProcs() << " "
+           << max_level << " " << finest_level << "\n";
+        for (int lev = 0; lev <= max_level; lev++)
+            os << istep[lev] << " " << t_new[lev] << " " << t_old[lev] << " " << dt[lev] << "\n";
+        os << dtcontrol.nominal << " " << dtcontrol.error_prev << "\n";
+        os << Util::RandomState() << "\n";
+
+        os << cell.number_of_fabs << "\n";
+        for (int i = 0; i < cell.number_of_fabs; i++)
+            os << cell.ncomp_array[i] << " " << cell.nghost_array[i] << " " << cell.name_array[i] << "\n";
+        os << node.number_of_fabs << "\n";
+        for (int i = 0; i < node.number_of_fabs; i++)
+            os << node.ncomp_array[i] << " " << node.nghost_array[i] << " " << node.name_array[i] << "\n";
+        os << m_basefields.size() << "\n";
+        for (unsigned int i = 0; i < m_basefields.size(); i++)
+            os << m_basefields[i]->NComp() << " " << m_basefields[i]->DataSize() << "\n";
+
+        for (int lev = 0; lev < nlevels; lev++)
+        {
+            os << geom[lev].Domain() << "\n";
+            grids[lev].writeOn(os);
+            os << "\n";
+            const amrex::Vector<int> &pmap = dmap[lev].ProcessorMap();
+            os << pmap.size();
+            for (unsigned int i = 0; i < pmap.size(); i++) os << " " << pmap[i];
+            os << "\n";
+        }
+        if (!os) Util::Abort(INFO,"Error writing ",dirname,"/Header");
+    }
+
+    const int rank = amrex::ParallelDescriptor::MyProc();
+    for (int lev = 0; lev < nlevels; lev++)
+    {
+        std::ofstream os(amrex::LevelFullPath(lev, dirname, "Level_") + "/" + amrex::Concatenate("Data_", rank, 5),
+                         std::ios::out | std::ios::binary);
+        for (int i = 0; i < cell.number_of_fabs; i++) IO::Checkpoint::Write(os, *(*cell.fab_array[i])[lev]);
+        for (int i = 0; i < node.number_of_fabs; i++) IO::Checkpoint::Write(os, *(*node.fab_array[i])[lev]);
+        for (unsigned int i = 0; i < m_basefields.size(); i++) m_basefields[i]->WriteCheckpoint(lev, os);
+    }
+    amrex::ParallelDescriptor::Barrier();
+    Util::Message(INFO,"Wrote checkpoint ",dirname);
+}
+
+void
+Integrator::ReadCheckpoint (std::string dirname)
+{
+    BL_PROFILE("Integrator::ReadCheckpoint");
+
+    amrex::Vector<char> buffer;
+    amrex::ParallelDescriptor::ReadAndBcastFile(dirname + "/Header", buffer);
+    std::istringstream is(std::string(buffer.dataPtr()), std::istringstream::in);
+
+    std::string line;
+    std::getline(is, line);
+    if (line != "alamo-checkpoint-1") Util::Abort(INFO,dirname," is not a checkpoint (header: ",line,")");
+
+    int tmp_dim, tmp_nprocs, tmp_max_level, tmp_finest_level;
+    is >> tmp_dim >> tmp_nprocs >> tmp_max_level >> tmp_finest_level;
+    if (tmp_dim != AMREX_SPACEDIM)
+        Util::Abort(INFO,"Checkpoint is ",tmp_dim,"D, but this is ",AMREX_SPACEDIM,"D");
+    // With a different number of ranks the grids are rechunked and redistributed
+    const bool redistribute = (tmp_nprocs != amrex::ParallelDescriptor::NProcs());
+    if (redistribute)
+        Util::Message(INFO,"Checkpoint was written with ",tmp_nprocs," ranks; redistributing onto ",amrex::ParallelDescriptor::NProcs());
+    if (tmp_max_level != max_level)
+        Util::Abort(INFO,"The max level specified (",max_level,") does not match the max level in the checkpoint (",tmp_max_level,")");
+
+    for (int lev = 0; lev <= max_level; lev++)
+        is >> istep[lev] >> t_new[lev] >> t_old[lev] >> dt[lev];
+    is >> dtcontrol.nominal >> dtcontrol.error_prev;
+    std::string random_state;
+    std::getline(is >> std::ws, random_state);
+
+    // The same fields must be registered, in the same order
+    auto check = [&](std::string kind, int number, const std::vector<int> &ncomp,
+                     const std::vector<int> &nghost, const std::vector<std::string> &names) {
+        int tmp_number;
+        is >> tmp_number;
+        if (tmp_number != number) Util::Abort(INFO,"Checkpoint has ",tmp_number," ",kind," fabs, expected ",number);
+        for (int i = 0; i < number; i++)
+        {
+            int tmp_ncomp, tmp_nghost;
+            is >> tmp_ncomp >> tmp_nghost;
+            std::getline(is >> std::ws, line);
+            if (line != names[i] || tmp_ncomp != ncomp[i] || tmp_nghost != nghost[i])
+                Util::Abort(INFO,"Checkpoint ",kind," fab ",i," is ",line," (ncomp=",tmp_ncomp,", nghost=",tmp_nghost,"), expected ",
+                            names[i]," (ncomp=",ncomp[i],", nghost=",nghost[i],")");
+        }
+    };
+    check("cell", cell.number_of_fabs, cell.ncomp_array, cell.nghost_array, cell.name_array);
+    check("node", node.number_of_fabs, node.ncomp_array, node.nghost_array, node.name_array);
+    unsigned int tmp_nbasefields;
+    is >> tmp_nbasefields;
+    if (tmp_nbasefields != m_basefields.size())
+        Util::Abort(INFO,"Checkpoint has ",tmp_nbasefields," general fields, expected ",m_basefields.size());
+    for (unsigned int i = 0; i < m_basefields.size(); i++)
+    {
+        int tmp_ncomp; std::size_t tmp_size;
+        is >> tmp_ncomp >> tmp_size;
+        if (tmp_ncomp != m_basefields[i]->NComp() || tmp_size != m_basefields[i]->DataSize())
+            Util::Abort(INFO,"Checkpoint general field ",i," does not match (ncomp=",tmp_ncomp,", size=",tmp_size,")");
+    }
+
+    const int rank = amrex::ParallelDescriptor::MyProc();
+    for (int lev = 0; lev <= tmp_finest_level; lev++)
+    {
+        amrex::Box domain;
+        is >> domain;
+        if (domain != geom[lev].Domain())
+            Util::Abort(INFO,"Checkpoint domain ",domain," on level ",lev," does not match ",geom[lev].Domain());
+        amrex::BoxArray ba;
+        ba.readFrom(is);
+        int nboxes;
+        is >> nboxes;
+        amrex::Vector<int> pmap(nboxes);
+        for (int i = 0; i < nboxes; i++) is >> pmap[i];
+        if (!is) Util::Abort(INFO,"Error reading ",dirname,"/Header");
+
+        amrex::BoxArray new_ba = ba;
+        if (redistribute)
+        {
+            new_ba.maxSize(maxGridSize(lev));
+            ChopGrids(lev, new_ba, amrex::ParallelDescriptor::NProcs());
+            SetBoxArray(lev, new_ba);
+            SetDistributionMap(lev, amrex::DistributionMapping(new_ba, amrex::ParallelDescriptor::NProcs()));
+        }
+        else
+        {
+            SetBoxArray(lev, ba);
+            SetDistributionMap(lev, amrex::DistributionMapping(pmap));
+        }
+
+        // Build the level as usual, so that boundary conditions and any state
+        // set up by the derived integrator exist, then overwrite all fields.
+        const Set::Scalar tmp_t_old = t_old[lev];
+        MakeNewLevelFromScratch(lev, t_new[lev], grids[lev], dmap[lev]);
+        t_old[lev] = tmp_t_old;
+
+        const std::string prefix = amrex::LevelFullPath(lev, dirname, "Level_") + "/Data_";
+        if (!redistribute)
+        {
+            std::string filename = amrex::Concatenate(prefix, rank, 5);
+            std::ifstream data(filename, std::ios::in | std::ios::binary);
+            if (!data) Util::Abort(INFO,"Could not open ",filename);
+            for (int i = 0; i < cell.number_of_fabs; i++) IO::Checkpoint::Read(data, *(*cell.fab_array[i])[lev]);
+            for (int i = 0; i < node.number_of_fabs; i++) IO::Checkpoint::Read(data, *(*node.fab_array[i])[lev]);
+            for (unsigned int i = 0; i < m_basefields.size(); i++) m_basefields[i]->ReadCheckpoint(lev, data);
+            continue;
+        }
+
+        // Each rank reads some of the checkpointed boxes, wherever they were
+        // written, and the data is then copied onto the new grids.
+        amrex::DistributionMapping tmp_dm(ba, amrex::ParallelDescriptor::NProcs());
+        amrex::BoxArray ngrids = ba;
+        ngrids.convert(amrex::IntVect::TheNodeVector());
+        std::vector<std::size_t> position(tmp_nprocs, 0);
+        for (int i = 0; i < cell.number_of_fabs; i++)
+        {
+            amrex::MultiFab tmp(ba, tmp_dm, cell.ncomp_array[i], cell.nghost_array[i]);
+            IO::Checkpoint::Read(prefix, tmp, pmap, position);
+            (*cell.fab_array[i])[lev]->ParallelCopy(tmp, 0, 0, cell.ncomp_array[i], cell.nghost_array[i], cell.nghost_array[i], geom[lev].periodicity());
+        }
+        for (int i = 0; i < node.number_of_fabs; i++)
+        {
+            amrex::MultiFab tmp(ngrids, tmp_dm, node.ncomp_array[i], node.nghost_array[i]);
+            IO::Checkpoint::Read(prefix, tmp, pmap, position);
+            (*node.fab_array[i])[lev]->ParallelCopy(tmp, 0, 0, node.ncomp_array[i], node.nghost_array[i], node.nghost_array[i], geom[lev].periodicity());
+        }
+        for (unsigned int i = 0; i < m_basefields.size(); i++)
+            m_basefields[i]->ReadCheckpoint(lev, prefix, ba, tmp_dm, pmap, position);
+    }
+
+    finest_level = tmp_finest_level;
+    SetFinestLevel(finest_level);
+
+    // Initialize may have drawn random numbers, so the state is restored last
+    Util::RandomState(random_state);
+    Util::Message(INFO,"Continuing from ",dirname," at step ",istep[0],", time ",t_new[0]);
+}
+
+void
+Integrator::EstimateCost (int /*lev*/, amrex::LayoutData<Set::Scalar> &cost)
+{
+    for (amrex::MFIter mfi(cost); mfi.isValid(); ++mfi)
+        cost[mfi] = (Set::Scalar)mfi.validbox().numPts();
+}
+
+//
+// The cost of every box is gathered on all ranks and the load of each rank
+// compared to the mean. Levels whose most loaded rank exceeds the mean by more
+// than the threshold are redistributed (same grids, new DistributionMapping)
+// if that improves the balance.
+//
+void
+Integrator::LoadBalance ()
+{
+    BL_PROFILE("Integrator::LoadBalance");
+    const int nprocs = amrex::ParallelDescriptor::NProcs();
+    loadbalance.imbalance = 1.0;
+    for (int lev = 0; lev <= finest_level; lev++)
+    {
+        amrex::LayoutData<Set::Scalar> cost(grids[lev], dmap[lev]);
+        EstimateCost(lev, cost);
+
+        amrex::Vector<amrex::Real> rcost(grids[lev].size(), 0.0);
+        for (amrex::MFIter mfi(cost); mfi.isValid(); ++mfi) rcost[mfi.index()] = cost[mfi];
+        amrex::ParallelDescriptor::ReduceRealSum(rcost.dataPtr(), rcost.size());
+
+        std::vector<Set::Scalar> load(nprocs, 0.0);
+        for (int i = 0; i < (int)rcost.size(); i++) load[dmap[lev][i]] += rcost[i];
+        const Set::Scalar mean = std::accumulate(load.begin(), load.end(), 0.0) / (Set::Scalar)nprocs;
+        if (mean <= 0.0) continue;
+        const Set::Scalar imbalance = *std::max_element(load.begin(), load.end()) / mean;
+        loadbalance.imbalance = std::max(loadbalance.imbalance, imbalance);
+        if (imbalance <= loadbalance.threshold) continue;
+
+        amrex::Real efficiency = 0.0;
+        amrex::DistributionMapping newdm = (loadbalance.strategy == "sfc") ?
+            amrex::DistributionMapping::makeSFC(rcost, grids[lev], efficiency) :
+            amrex::DistributionMapping::makeKnapSack(rcost, efficiency);
+        if (efficiency <= 0.0 || 1.0/efficiency >= imbalance) continue;
+
+        Util::Message(INFO,"Level ",lev,": load imbalance ",imbalance," -> ",1.0/efficiency," (",loadbalance.strategy,")");
+        RemakeLevel(lev, t_new[lev], grids[lev], newdm);
+        SetDistributionMap(lev, newdm);
+        loadbalance.count++;
+    }
+}
+
 void
 Integrator::MakeNewLevelFromScratch (int lev, amrex::Real t, const amrex::BoxArray& cgrids,
                                     const amrex::DistributionMapping& dm)
@@ -747,8 +1236,8 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
     int nlevels = finest_level+1;
     if (max_plot_level >= 0) nlevels = std::min(nlevels,max_plot_level);
 
-    int ccomponents = 0, ncomponents = 0, bfcomponents = 0;
-    amrex::Vector<std::string> cnames, nnames, bfnames;
+    int ccomponents = 0, ncomponents = 0, bfcomponents = 0, bfccomponents = 0;
+    amrex::Vector<std::string> cnames, nnames, bfnames, bfcnames;
     for (int i = 0; i < cell.number_of_fabs; i++)
     {
         if (!cell.writeout_array[i]) continue;
@@ -771,7 +1260,13 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
     }
     for (unsigned int i = 0; i< m_basefields.size(); i++)
     {
-        if (m_basefields[i]->writeout)
+        if (m_basefields[i]->writeout && m_basefields[i]->IxType().cellCentered())
+        {
+            bfccomponents += m_basefields[i]->NComp();
+            for (int j = 0; j < m_basefields[i]->NComp(); j++)
+                bfcnames.push_back(m_basefields[i]->Name(j));
+        }
+        else if (m_basefields[i]->writeout)
         {
             bfcomponents += m_basefields[i]->NComp();
             for (int j = 0; j < m_basefields[i]->NComp(); j++)
@@ -779,16 +1274,23 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
         }
     }
 
+    // Backpressure: wait here while plot_async.max_pending plotfiles
+    // are still queued on the background writer.
+    if (plot_async.on) plot_async.queue->Acquire(plot_async.max_pending);
+
+    // Non-finite output only stops the run if amr.check_finite_int is set
+    CheckFinite("WritePlotFile", true, check_finite_int > 0);
+
     amrex::Vector<amrex::MultiFab> cplotmf(nlevels), nplotmf(nlevels);
 
-    bool do_cell_plotfile = (ccomponents > 0 || (ncomponents+bfcomponents > 0 && cell.all)) && cell.any;
-    bool do_node_plotfile = (ncomponents+bfcomponents > 0 || (ccomponents > 0 && node.all)) && node.any;
+    bool do_cell_plotfile = (ccomponents+bfccomponents > 0 || (ncomponents+bfcomponents > 0 && cell.all)) && cell.any;
+    bool do_node_plotfile = (ncomponents+bfcomponents > 0 || (ccomponents+bfccomponents > 0 && node.all)) && node.any;
   
     for (int ilev = 0; ilev < nlevels; ++ilev)
     {
         if (do_cell_plotfile)
         {
-            int ncomp = ccomponents;
+            int ncomp = ccomponents + bfccomponents;
             if (cell.all) ncomp += ncomponents + bfcomponents;
             cplotmf[ilev].define(grids[ilev], dmap[ilev], ncomp, 0);
 
@@ -796,19 +1298,23 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
             for (int i = 0; i < cell.number_of_fabs; i++)
             {
                 if (!cell.writeout_array[i]) continue;
-                if ((*cell.fab_array[i])[ilev]->contains_nan()) Util::Abort(INFO,cnames[i]," contains nan (i=",i,")");
-                if ((*cell.fab_array[i])[ilev]->contains_inf()) Util::Abort(INFO,cnames[i]," contains inf (i=",i,")");
                 amrex::MultiFab::Copy(cplotmf[ilev], *(*cell.fab_array[i])[ilev], 0, n, cell.ncomp_array[i], 0);
                 n += cell.ncomp_array[i];
             }
+            for (unsigned int i = 0; i < m_basefields.size(); i++)
+            {
+                if (m_basefields[i]->writeout && m_basefields[i]->IxType().cellCentered())
+                {
+                    m_basefields[i]->Copy(ilev, cplotmf[ilev], n, 0);
+                    n += m_basefields[i]->NComp();
+                }
+            }
             
             if (cell.all)
             {
                 for (int i = 0; i < node.number_of_fabs; i++)
                 {
                     if (!node.writeout_array[i]) continue;
-                    if ((*node.fab_array[i])[ilev]->contains_nan()) Util::Abort(INFO,nnames[i]," contains nan (i=",i,")");
-                    if ((*node.fab_array[i])[ilev]->contains_inf()) Util::Abort(INFO,nnames[i]," contains inf (i=",i,")");
                     amrex::average_node_to_cellcenter(cplotmf[ilev],n,*(*node.fab_array[i])[ilev],0,node.ncomp_array[i],0);
                     n += node.ncomp_array[i];
                 } 
@@ -821,7 +1327,7 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
                     int ctr = 0;
                     for (unsigned int i = 0; i < m_basefields.size(); i++)
                     {
-                        if (m_basefields[i]->writeout)
+                        if (m_basefields[i]->writeout && m_basefields[i]->IxType().nodeCentered())
                         {
                             m_basefields[i]->Copy(ilev,bfplotmf,ctr,0);
                             ctr += m_basefields[i]->NComp();
@@ -838,21 +1344,19 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
             amrex::BoxArray ngrids = grids[ilev];
             ngrids.convert(amrex::IntVect::TheNodeVector());
             int ncomp = ncomponents + bfcomponents;
-            if (node.all) ncomp += ccomponents;
+            if (node.all) ncomp += ccomponents + bfccomponents;
             nplotmf[ilev].define(ngrids, dmap[ilev], ncomp, 0);
             
             int n = 0;
             for (int i = 0; i < node.number_of_fabs; i++)
             {
                 if (!node.writeout_array[i]) continue;
-                if ((*node.fab_array[i])[ilev]->contains_nan()) Util::Warning(INFO,nnames[i]," contains nan (i=",i,"). Resetting to zero.");
-                if ((*node.fab_array[i])[ilev]->contains_inf()) Util::Abort(INFO,nnames[i]," contains inf (i=",i,")");
                 amrex::MultiFab::Copy(nplotmf[ilev], *(*node.fab_array[i])[ilev], 0, n, node.ncomp_array[i], 0);
                 n += node.ncomp_array[i];
             }
             for (unsigned int i = 0; i<m_basefields.size(); i++)
             {
-                if (m_basefields[i]->writeout)
+                if (m_basefields[i]->writeout && m_basefields[i]->IxType().nodeCentered())
                 {
                     m_basefields[i]->Copy(ilev, nplotmf[ilev], n, 0);
                     n += m_basefields[i]->NComp();
@@ -864,8 +1368,6 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
                 for (int i = 0; i < cell.number_of_fabs; i++)
                 {
                     if (!cell.writeout_array[i]) continue;
-                    if ((*cell.fab_array[i])[ilev]->contains_nan()) Util::Warning(INFO,cnames[i]," contains nan (i=",i,"). Resetting to zero.");
-                    if ((*cell.fab_array[i])[ilev]->contains_inf()) Util::Abort(INFO,cnames[i]," contains inf (i=",i,")");
                     if ((*cell.fab_array[i])[ilev]->nGrow()==0)
                     {
                         if (initial) Util::Warning(INFO,cnames[i]," has no ghost cells and will not be included in nodal output");
@@ -874,6 +1376,23 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
                     Util::AverageCellcenterToNode(nplotmf[ilev],n,*(*cell.fab_array[i])[ilev],0,cell.ncomp_array[i]);
                     n += cell.ncomp_array[i];
                 }
+                if (bfccomponents > 0)
+                {
+                    amrex::MultiFab bfplotmf(grids[ilev],dmap[ilev],bfccomponents,1);
+                    bfplotmf.setVal(0.0);
+                    int ctr = 0;
+                    for (unsigned int i = 0; i < m_basefields.size(); i++)
+                    {
+                        if (m_basefields[i]->writeout && m_basefields[i]->IxType().cellCentered())
+                        {
+                            m_basefields[i]->Copy(ilev,bfplotmf,ctr,0);
+                            ctr += m_basefields[i]->NComp();
+                        }
+                    }
+                    bfplotmf.FillBoundary(Geom(ilev).periodicity());
+                    Util::AverageCellcenterToNode(nplotmf[ilev],n,bfplotmf,0,bfccomponents);
+                    n += bfccomponents;
+                }
             }
         }
     }
@@ -884,49 +1403,74 @@ Integrator::WritePlotFile (Set::Scalar time, amrex::Vector<int> iter, bool initi
     if (do_cell_plotfile)
     {
         amrex::Vector<std::string> allnames = cnames;
+        allnames.insert(allnames.end(),bfcnames.begin(),bfcnames.end());
         if (cell.all) {
             allnames.insert(allnames.end(),nnames.begin(),nnames.end());
             allnames.insert(allnames.end(),bfnames.begin(),bfnames.end());
         }
         WriteMultiLevelPlotfile(plotfilename[0]+plotfilename[1]+"cell", nlevels, amrex::GetVecOfConstPtrs(cplotmf), allnames,
                                 Geom(), time, iter, refRatio());
-    
-        std::ofstream chkptfile;
-        chkptfile.open(plotfilename[0]+plotfilename[1]+"cell/Checkpoint");
-        for (int i = 0; i <= max_level; i++) boxArray(i).writeOn(chkptfile);
-        chkptfile.close();
     }
 
     if (do_node_plotfile)
     {
         amrex::Vector<std::string> allnames = nnames;
         allnames.insert(allnames.end(),bfnames.begin(),bfnames.end());
-        if (node.all) allnames.insert(allnames.end(),cnames.begin(),cnames.end());
+        if (node.all) {
+            allnames.insert(allnames.end(),cnames.begin(),cnames.end());
+            allnames.insert(allnames.end(),bfcnames.begin(),bfcnames.end());
+        }
         WriteMultiLevelPlotfile(plotfilename[0]+plotfilename[1]+"node", nlevels, amrex::GetVecOfConstPtrs(nplotmf), allnames,
                                 Geom(), time, iter, refRatio());
-
-        std::ofstream chkptfile;
-        chkptfile.open(plotfilename[0]+plotfilename[1]+"node/Checkpoint");
-        for (int i = 0; i <= max_level; i++) boxArray(i).writeOn(chkptfile);
-        chkptfile.close();
     }
 
-    if (amrex::ParallelDescriptor::IOProcessor())
+    //
+    // The Checkpoint files and the .visit index entries refer to data that
+    // must already be on disk. In asynchronous mode they are therefore
+    // queued behind the field data on the AsyncOut thread; everything is
+    // captured by value because the task outlives this call.
+    //
+    amrex::Vector<amrex::BoxArray> boxarrays(max_level+1);
+    for (int i = 0; i <= max_level; i++) boxarrays[i] = boxArray(i);
+    bool write_cell_index = (ccomponents + bfccomponents > 0 || cell.all) && cell.any;
+    bool write_node_index = (ncomponents > 0 || node.all) && node.any;
+    bool write_node_entry = ncomponents > 0;
+    bool first = (istep[0]==0);
+    std::string outdir = plot_file;
+    std::shared_ptr<PlotQueue> queue = plot_async.queue;
+    bool async = plot_async.on;
+
+    auto finalize = [=]()
     {
-        std::ofstream coutfile, noutfile;
-        if (istep[0]==0)
-        {
-            if ((ccomponents > 0 || cell.all) && cell.any) coutfile.open(plot_file+"/celloutput.visit",std::ios_base::out);
-            if ((ncomponents > 0 || node.all) && node.any) noutfile.open(plot_file+"/nodeoutput.visit",std::ios_base::out);
-        }
-        else
+        if (amrex::ParallelDescriptor::IOProcessor())
         {
-            if ((ccomponents > 0 || cell.all) && cell.any) coutfile.open(plot_file+"/celloutput.visit",std::ios_base::app);
-            if ((ncomponents > 0 || node.all) && node.any) noutfile.open(plot_file+"/nodeoutput.visit",std::ios_base::app);
+            if (do_cell_plotfile)
+            {
+                std::ofstream chkptfile;
+                chkptfile.open(plotfilename[0]+plotfilename[1]+"cell/Checkpoint");
+                for (unsigned int i = 0; i < boxarrays.size(); i++) boxarrays[i].writeOn(chkptfile);
+                chkptfile.close();
+            }
+            if (do_node_plotfile)
+            {
+                std::ofstream chkptfile;
+                chkptfile.open(plotfilename[0]+plotfilename[1]+"node/Checkpoint");
+                for (unsigned int i = 0; i < boxarrays.size(); i++) boxarrays[i].writeOn(chkptfile);
+                chkptfile.close();
+            }
+
+            std::ofstream coutfile, noutfile;
+            std::ios_base::openmode mode = first ? std::ios_base::out : std::ios_base::app;
+            if (write_cell_index) coutfile.open(outdir+"/celloutput.visit",mode);
+            if (write_node_index) noutfile.open(outdir+"/nodeoutput.visit",mode);
+            coutfile << plotfilename[1] + "cell" + "/Header" << std::endl;
+            if (write_node_entry) noutfile << plotfilename[1] + "node" + "/Header" << std::endl;
         }
-        coutfile << plotfilename[1] + "cell" + "/Header" << std::endl;
-        if (ncomponents > 0) noutfile << plotfilename[1] + "node" + "/Header" << std::endl;
-    }
+        if (async) queue->Release();
+    };
+
+    if (async) amrex::AsyncOut::Submit(finalize);
+    else finalize();
 }
 
 void
@@ -943,11 +1487,36 @@ Integrator::Evolve ()
         }
         int lev = 0;
         int iteration = 1;
+        if (loadbalance.interval > 0 && step > 0 && step % loadbalance.interval == 0) LoadBalance();
+        if (dtcontrol.adaptive) ControlTimestep(cur_time);
         TimeStepBegin(cur_time,step);
         if (integrate_variables_before_advance) IntegrateVariables(cur_time,step);
+        // Fields registered with RegisterGeneralFab are not saved, so those steps are never retried
+        const bool reject = dtcontrol.adaptive && dtcontrol.reject && dtcontrol.estimate != 0 && m_basefields.empty();
+        if (reject) SaveState();
         TimeStep(lev, cur_time, iteration);
+        for (int rejects = 0; reject && RejectTimestep(cur_time, rejects); rejects++)
+        {
+            TimeStepBegin(cur_time,step);
+            TimeStep(lev, cur_time, iteration);
+        }
         if (integrate_variables_after_advance) IntegrateVariables(cur_time,step);
         TimeStepComplete(cur_time,step);
+        if (check_finite_int > 0 && (step+1) % check_finite_int == 0)
+            CheckFinite("step " + std::to_string(step+1));
+        if (dtcontrol.adaptive)
+        {
+            // PI control on the normalized error; without an error estimate, just grow
+            Set::Scalar error = TimestepError();
+            Set::Scalar factor = dtcontrol.growth;
+            if (error >= 0.0)
+            {
+                error = std::max(error / dtcontrol.tolerance, 1E-10);
+                factor = dtcontrol.safety * std::pow(error, -dtcontrol.ki) * std::pow(dtcontrol.error_prev, dtcontrol.kp);
+                dtcontrol.error_prev = error;
+            }
+            dtcontrol.nominal *= std::min(std::max(factor, 0.1), dtcontrol.growth);
+        }
         cur_time += dt[0];
 
         if (amrex::ParallelDescriptor::IOProcessor()) {
@@ -966,69 +1535,93 @@ Integrator::Evolve ()
             WritePlotFile();
             IO::WriteMetaData(plot_file,IO::Status::Running,(int)(100.0*cur_time/stop_time));
         }
-        else if (std::fabs(std::remainder(cur_time,plot_dt)) < 0.5*dt[0])
+        else if (dtcontrol.adaptive ? (plot_dt > 0.0 && cur_time >= dtcontrol.next_plot - 1E-8*dt[0])
+                                    : std::fabs(std::remainder(cur_time,plot_dt)) < 0.5*dt[0])
         {
             last_plot_file_step = step+1;
             WritePlotFile();
             IO::WriteMetaData(plot_file,IO::Status::Running,(int)(100.0*cur_time/stop_time));
+            while (dtcontrol.next_plot <= cur_time + 1E-8*dt[0]) dtcontrol.next_plot += plot_dt;
         }
 
+        if (checkpoint_int > 0 && (step+1) % checkpoint_int == 0) WriteCheckpoint();
+
+        // thermo.dat is buffered; flush it whenever a plotfile is written
+        if (last_plot_file_step == step+1 && thermo.file.is_open()) thermo.file.flush();
+
         if (cur_time >= stop_time - 1.e-6*dt[0]) break;
     }
     if (plot_int > 0 && istep[0] > last_plot_file_step) {
         WritePlotFile();
     }
+    if (plot_async.on) plot_async.queue->Wait();
+    if (narrowband.regrids + narrowband.skipped > 0)
+        Util::Message(INFO,"Regrids: ",narrowband.regrids," performed, ",narrowband.skipped," skipped, ",
+                      narrowband.time," s total");
 }
 
 void
 Integrator::IntegrateVariables (amrex::Real time, int step)
 {
     BL_PROFILE("Integrator::IntegrateVariables");
-    if (!thermo.number) return;
+    if (!thermo.number && !dtcontrol.adaptive && !loadbalance.interval) return;
 
-    if ( (thermo.interval > 0 && (step) % thermo.interval == 0) ||
-        ((thermo.dt > 0.0) && (std::fabs(std::remainder(time,plot_dt)) < 0.5*dt[0])) )
+    if ( thermo.number && ((thermo.interval > 0 && (step) % thermo.interval == 0) ||
+        ((thermo.dt > 0.0) && (std::fabs(std::remainder(time,thermo.dt)) < 0.5*dt[0]))) )
     {
-        // Zero out all variables
-        for (int i = 0; i < thermo.number; i++) *thermo.vars[i] = 0; 
-
-        // All levels except the finest
-        for (int ilev = 0; ilev < max_level; ilev++)
-        {
-            const amrex::BoxArray& cfba = amrex::coarsen(grids[ilev+1], refRatio(ilev));
+        // Each thread accumulates into its own slot. Slots are padded to
+        // separate cache lines to avoid false sharing.
+        const int stride = ((thermo.number + 7)/8)*8;
+#ifdef _OPENMP
+        const int nthreads = omp_get_max_threads();
+#else
+        const int nthreads = 1;
+#endif
+        std::vector<Set::Scalar> partial(nthreads*stride, 0.0);
 
-#ifdef OMP
+#ifdef _OPENMP
 #pragma omp parallel
 #endif
-            for ( amrex::MFIter mfi(grids[ilev],dmap[ilev],true); mfi.isValid(); ++mfi )
+        {
+#ifdef _OPENMP
+            const int tid = omp_get_thread_num();
+#else
+            const int tid = 0;
+#endif
+            ThermoSum sum(thermo.vars, partial.data() + tid*stride);
+
+            // All levels except the finest
+            for (int ilev = 0; ilev < finest_level; ilev++)
             {
-                const amrex::Box& box = mfi.tilebox();
-                const amrex::BoxArray & comp = amrex::complementIn(box,cfba);
+                const amrex::BoxArray& cfba = amrex::coarsen(grids[ilev+1], refRatio(ilev));
 
-                for (int i = 0; i < comp.size(); i++)
+                for ( amrex::MFIter mfi(grids[ilev],dmap[ilev],true); mfi.isValid(); ++mfi )
                 {
-                    Integrate(ilev,time, step,
-                            mfi, comp[i]);
+                    const amrex::Box& box = mfi.tilebox();
+                    const amrex::BoxArray & comp = amrex::complementIn(box,cfba);
+
+                    for (int i = 0; i < comp.size(); i++)
+                    {
+                        Integrate(ilev, time, step, mfi, comp[i], sum);
+                    }
                 }
             }
-        }
-        // Now do the finest level
-        {
-#ifdef OMP
-#pragma omp parallel
-#endif 
-            for ( amrex::MFIter mfi(grids[max_level],dmap[max_level],true); mfi.isValid(); ++mfi )
+            // Now do the finest level
+            for ( amrex::MFIter mfi(grids[finest_level],dmap[finest_level],true); mfi.isValid(); ++mfi )
             {
                 const amrex::Box& box = mfi.tilebox();
-                Integrate(max_level, time, step, mfi, box);
+                Integrate(finest_level, time, step, mfi, box, sum);
             }
         }
 
-        // Sum up across all processors
-        for (int i = 0; i < thermo.number; i++) 
-        {
-            amrex::ParallelDescriptor::ReduceRealSum(*thermo.vars[i]);
-        }
+        // Combine threads (in a fixed order) and then sum up across all
+        // processors in a single reduction
+        std::vector<Set::Scalar> total(thermo.number, 0.0);
+        for (int t = 0; t < nthreads; t++)
+            for (int i = 0; i < thermo.number; i++)
+                total[i] += partial[t*stride + i];
+        amrex::ParallelDescriptor::ReduceRealSum(total.data(), thermo.number);
+        for (int i = 0; i < thermo.number; i++) *thermo.vars[i] = total[i];
     }
     if ( amrex::ParallelDescriptor::IOProcessor() &&
         (
@@ -1036,26 +1629,272 @@ Integrator::IntegrateVariables (amrex::Real time, int step)
             (thermo.plot_dt > 0.0 && std::fabs(std::remainder(time,thermo.plot_dt)) < 0.5*dt[0])
             ))
     {
-        std::ofstream outfile;
-        if (step==0)
+        if (!thermo.file.is_open())
         {
-            outfile.open(plot_file+"/thermo.dat",std::ios_base::out);
-            outfile << "time";
-            for (int i = 0; i < thermo.number; i++) 
-                outfile << "\t" << thermo.names[i];
-            outfile << std::endl;
+            if (step==0)
+            {
+                thermo.file.open(plot_file+"/thermo.dat",std::ios_base::out);
+                thermo.file << "time";
+                for (int i = 0; i < thermo.number; i++) 
+                    thermo.file << "\t" << thermo.names[i];
+                if (dtcontrol.adaptive) thermo.file << "\tdt";
+                if (loadbalance.interval) thermo.file << "\timbalance\trebalanced";
+                thermo.file << "\n";
+            }
+            else thermo.file.open(plot_file+"/thermo.dat",std::ios_base::app);
         }
-        else outfile.open(plot_file+"/thermo.dat",std::ios_base::app);
-        outfile << time;
+        thermo.file << time;
         for (int i = 0; i < thermo.number; i++)
-            outfile << "\t" << *thermo.vars[i];
-        outfile << std::endl;
-        outfile.close();
+            thermo.file << "\t" << *thermo.vars[i];
+        if (dtcontrol.adaptive) thermo.file << "\t" << dt[0];
+        if (loadbalance.interval) thermo.file << "\t" << loadbalance.imbalance << "\t" << loadbalance.count;
+        thermo.file << "\n";
+    }
+
+}
+
+void
+Integrator::ControlTimestep (Set::Scalar cur_time)
+{
+    BL_PROFILE("Integrator::ControlTimestep");
+    Set::Scalar nominal = std::min(std::max(dtcontrol.nominal, dtcontrol.min), dtcontrol.max);
+
+    // The stable timestep of each level, converted to a coarse-level timestep
+    Set::Scalar stable = std::numeric_limits<Set::Scalar>::infinity();
+    Set::Scalar substeps = 1.0;
+    for (int lev = 0; lev <= finest_level; lev++)
+    {
+        if (lev > 0) substeps *= (Set::Scalar)nsubsteps[lev];
+        stable = std::min(stable, dtcontrol.cfl * StableTimestep(lev) * substeps);
+    }
+    amrex::ParallelDescriptor::ReduceRealMin(stable);
+    if (stable < dtcontrol.min)
+        Util::Warning(INFO,"stable timestep ",stable," is below dt.min = ",dtcontrol.min,"; using the stable timestep");
+    nominal = std::min(nominal, stable);
+    dtcontrol.nominal = nominal;
+
+    // Land exactly on the next plot time (advanced by Evolve after each plot) and on the stop time
+    Set::Scalar step = nominal;
+    if (plot_dt > 0.0)
+    {
+        if (dtcontrol.next_plot < 0.0)
+            dtcontrol.next_plot = plot_dt * (std::floor(cur_time / plot_dt + 1E-8) + 1.0);
+        if (cur_time + step > dtcontrol.next_plot - 1E-8 * step) step = dtcontrol.next_plot - cur_time;
+    }
+    if (cur_time + step > stop_time) step = stop_time - cur_time;
+
+    SetTimestep(step);
+    dtcontrol.nominal = nominal;
+}
+
+/// Called after each adaptive step: if its error estimate exceeds dt.tolerance,
+/// restore the state saved by SaveState, cut the timestep and return true so
+/// that the step is retried. A step is accepted anyway, with a warning, at dt.min,
+/// after dt.max_rejects retries, or if the grids changed while it was taken.
+bool
+Integrator::RejectTimestep (Set::Scalar cur_time, int rejects)
+{
+    BL_PROFILE("Integrator::RejectTimestep");
+    Set::Scalar error = TimestepError();
+    dtcontrol.estimate = (error >= 0.0);
+    if (error <= dtcontrol.tolerance) return false;
+
+    if (rejects >= dtcontrol.max_rejects || dt[0] <= dtcontrol.min)
+    {
+        Util::Warning(INFO,"accepting a step with error ",error," > dt.tolerance = ",dtcontrol.tolerance,
+                      " (dt = ",dt[0],", ",rejects," retries)");
+        return false;
+    }
+    if (!RestoreState())
+    {
+        Util::Warning(INFO,"the grids changed during the step; accepting it with error ",error);
+        return false;
+    }
+
+    Set::Scalar factor = std::max(dtcontrol.safety * std::pow(error / dtcontrol.tolerance, -dtcontrol.ki), 0.1);
+    if (amrex::ParallelDescriptor::IOProcessor())
+        std::cout << "Rejected step with DT = " << dt[0] << " (error " << error << "); retrying with DT = "
+                  << factor * dt[0] << std::endl;
+    dtcontrol.nominal = factor * dt[0];
+    ControlTimestep(cur_time);
+    return true;
+}
+
+void
+Integrator::SaveState ()
+{
+    BL_PROFILE("Integrator::SaveState");
+    std::vector<Set::Field<Set::Scalar> *> fabs(cell.fab_array);
+    fabs.insert(fabs.end(), node.fab_array.begin(), node.fab_array.end());
+
+    auto &saved = dtcontrol.saved;
+    saved.istep = istep;
+    saved.t_new = t_new;
+    saved.t_old = t_old;
+    saved.finest_level = finest_level;
+    saved.fabs.resize(fabs.size());
+    for (unsigned int n = 0; n < fabs.size(); n++)
+    {
+        saved.fabs[n].resize(finest_level + 1);
+        for (int lev = 0; lev <= finest_level; lev++)
+        {
+            const amrex::MultiFab &mf = *(*fabs[n])[lev];
+            std::unique_ptr<amrex::MultiFab> &copy = saved.fabs[n][lev];
+            // The copies are reused for as long as the grids do not change
+            if (!copy || copy->boxArray() != mf.boxArray() || copy->DistributionMap() != mf.DistributionMap())
+                copy.reset(new amrex::MultiFab(mf.boxArray(), mf.DistributionMap(), mf.nComp(), mf.nGrow()));
+            amrex::MultiFab::Copy(*copy, mf, 0, 0, mf.nComp(), mf.nGrow());
+        }
     }
+}
 
+/// Restore the state saved by SaveState. Returns false, and leaves everything
+/// unchanged, if the grids have changed since.
+bool
+Integrator::RestoreState ()
+{
+    BL_PROFILE("Integrator::RestoreState");
+    std::vector<Set::Field<Set::Scalar> *> fabs(cell.fab_array);
+    fabs.insert(fabs.end(), node.fab_array.begin(), node.fab_array.end());
+
+    auto &saved = dtcontrol.saved;
+    if (finest_level != saved.finest_level || fabs.size() != saved.fabs.size()) return false;
+    for (unsigned int n = 0; n < fabs.size(); n++)
+        for (int lev = 0; lev <= finest_level; lev++)
+        {
+            const amrex::MultiFab &mf = *(*fabs[n])[lev];
+            if (saved.fabs[n][lev]->boxArray() != mf.boxArray() ||
+                saved.fabs[n][lev]->DistributionMap() != mf.DistributionMap()) return false;
+        }
+
+    for (unsigned int n = 0; n < fabs.size(); n++)
+        for (int lev = 0; lev <= finest_level; lev++)
+        {
+            amrex::MultiFab &mf = *(*fabs[n])[lev];
+            amrex::MultiFab::Copy(mf, *saved.fabs[n][lev], 0, 0, mf.nComp(), mf.nGrow());
+        }
+    istep = saved.istep;
+    t_new = saved.t_new;
+    t_old = saved.t_old;
+    return true;
 }
 
 
+void
+Integrator::CheckFinite (std::string where, bool writeout_only, bool abort) const
+{
+    BL_PROFILE("Integrator::CheckFinite");
+    const int nlevels = finest_level + 1;
+
+    // Fields registered with RegisterGeneralFab are copied to scalar MultiFabs
+    // (as for plotting); fields without scalar components are skipped.
+    std::vector<amrex::Vector<amrex::MultiFab>> basecopies;
+    std::vector<std::string> basenames;
+    for (unsigned int i = 0; i < m_basefields.size(); i++)
+    {
+        if ((writeout_only && !m_basefields[i]->writeout) || m_basefields[i]->NComp() == 0) continue;
+        basecopies.emplace_back(nlevels);
+        for (int lev = 0; lev < nlevels; lev++)
+        {
+            basecopies.back()[lev].define(amrex::convert(grids[lev], m_basefields[i]->IxType()), dmap[lev],
+                                          m_basefields[i]->NComp(), 0);
+            m_basefields[i]->Copy(lev, basecopies.back()[lev], 0, 0);
+        }
+        basenames.push_back(m_basefields[i]->Name(0));
+    }
+
+    std::vector<amrex::Vector<const amrex::MultiFab *>> fabs;
+    std::vector<std::string> names;
+    auto add = [&](const Set::Field<Set::Scalar> &field, std::string name) {
+        fabs.emplace_back(nlevels);
+        for (int lev = 0; lev < nlevels; lev++) fabs.back()[lev] = field[lev].get();
+        names.push_back(name);
+    };
+    for (int i = 0; i < cell.number_of_fabs; i++)
+        if (!writeout_only || cell.writeout_array[i]) add(*cell.fab_array[i], cell.name_array[i]);
+    for (int i = 0; i < node.number_of_fabs; i++)
+        if (!writeout_only || node.writeout_array[i]) add(*node.fab_array[i], node.name_array[i]);
+    for (unsigned int i = 0; i < basecopies.size(); i++)
+    {
+        fabs.emplace_back(nlevels);
+        for (int lev = 0; lev < nlevels; lev++) fabs.back()[lev] = &basecopies[i][lev];
+        names.push_back(basenames[i]);
+    }
+    const int nfabs = fabs.size();
+    if (nfabs == 0) return;
+
+    // For every fab and level: the number of non-finite values and the smallest
+    // (cell,component) index at which one occurs, counted from the domain corner.
+    // All components are checked in a single pass over each fab, and everything is
+    // reduced across ranks at once.
+    amrex::Vector<int> count(nfabs*nlevels, 0);
+    amrex::Vector<amrex::Long> first(nfabs*nlevels, std::numeric_limits<amrex::Long>::max());
+    for (int lev = 0; lev < nlevels; lev++)
+        for (int f = 0; f < nfabs; f++)
+        {
+            const amrex::MultiFab &mf = *fabs[f][lev];
+            const int ncomp = mf.nComp();
+            const amrex::Box domain = amrex::convert(geom[lev].Domain(), mf.ixType());
+            const amrex::IntVect lo = domain.smallEnd(), len = domain.length();
+
+            amrex::ReduceOps<amrex::ReduceOpSum, amrex::ReduceOpMin> reduce_op;
+            amrex::ReduceData<int, amrex::Long> reduce_data(reduce_op);
+            using ReduceTuple = typename decltype(reduce_data)::Type;
+            for (amrex::MFIter mfi(mf); mfi.isValid(); ++mfi)
+            {
+                const amrex::Box &bx = mfi.validbox();
+                amrex::Array4<const Set::Scalar> const &a = mf.const_array(mfi);
+                reduce_op.eval(bx, reduce_data, [=] AMREX_GPU_DEVICE(int i, int j, int k) -> ReduceTuple
+                {
+                    int bad = 0;
+                    amrex::Long index = std::numeric_limits<amrex::Long>::max();
+                    for (int n = 0; n < ncomp; n++)
+                    {
+                        if (std::isfinite(a(i,j,k,n))) continue;
+                        if (!bad)
+                        {
+                            amrex::Long cell = AMREX_D_TERM((amrex::Long)(i-lo[0]),
+                                                            + (amrex::Long)len[0]*(j-lo[1]),
+                                                            + (amrex::Long)len[0]*len[1]*(k-lo[2]));
+                            index = cell*ncomp + n;
+                        }
+                        bad++;
+                    }
+                    return {bad, index};
+                });
+            }
+            ReduceTuple result = reduce_data.value();
+            count[lev*nfabs + f] = amrex::get<0>(result);
+            first[lev*nfabs + f] = amrex::get<1>(result);
+        }
+    amrex::ParallelDescriptor::ReduceIntSum(count.data(), count.size());
+    amrex::ParallelDescriptor::ReduceLongMin(first.data(), first.size());
+
+    for (int lev = 0; lev < nlevels; lev++)
+        for (int f = 0; f < nfabs; f++)
+        {
+            if (!count[lev*nfabs + f]) continue;
+            const amrex::MultiFab &mf = *fabs[f][lev];
+            const amrex::Box domain = amrex::convert(geom[lev].Domain(), mf.ixType());
+            const amrex::IntVect len = domain.length();
+            amrex::Long index = first[lev*nfabs + f];
+            const int n = index % mf.nComp();
+            amrex::Long cell = index / mf.nComp();
+            amrex::IntVect loc;
+            for (int d = 0; d < AMREX_SPACEDIM; d++) { loc[d] = domain.smallEnd(d) + cell % len[d]; cell /= len[d]; }
+
+            Set::Vector x;
+            for (int d = 0; d < AMREX_SPACEDIM; d++)
+                x(d) = geom[lev].ProbLo()[d] + (loc[d] + (mf.ixType().cellCentered(d) ? 0.5 : 0.0))*geom[lev].CellSize()[d];
+            if (abort)
+                Util::Abort(INFO,where,": ",names[f]," contains ",count[lev*nfabs + f]," non-finite values on level ",lev,
+                            "; the first is component ",n," at ",loc," (x = ",x.transpose(),")");
+            else
+                Util::Warning(INFO,where,": ",names[f]," contains ",count[lev*nfabs + f]," non-finite values on level ",lev,
+                              "; the first is component ",n," at ",loc," (x = ",x.transpose(),")");
+        }
+}
+
 void
 Integrator::TimeStep (int lev, amrex::Real time, int /*iteration*/)
 {
@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include <AMReX_SPACE.H>
+#include <AMReX_Reduce.H>
 
 #include "PhaseFieldMicrostructure.H"
 #include "BC/Constant.H"
@@ -39,6 +40,14 @@ PhaseFieldMicrostructure::PhaseFieldMicrostructure() : Integrator()
         pp.query("elastic_mult",pf.elastic_mult);           // Multiplier of elastic energy
         pp.query("elastic_threshold",pf.elastic_threshold); // Elastic threshold (:math:`\phi_0`)
         pf.L = (4./3.)*pf.M / pf.l_gb;
+
+        pp.query("sparse.on", sparse.on);                   // Store only the grains that are present in each cell
+        pp.query("sparse.threshold", sparse.threshold);     // Grains at or below this value are dropped from a cell
+        // Maximum number of grains stored in a cell (default: the smaller of 8 and number_of_grains)
+        sparse.capacity = std::min(sparse_max_capacity, number_of_grains);
+        pp.query("sparse.capacity", sparse.capacity);
+        if (sparse.on && (sparse.capacity < 1 || sparse.capacity > std::min(sparse_max_capacity, number_of_grains)))
+            Util::Abort(INFO,"pf.sparse.capacity = ",sparse.capacity," must be between 1 and min(",sparse_max_capacity,", pf.number_of_grains = ",number_of_grains,")");
     }
     {
         amrex::ParmParse pp("amr");
@@ -107,6 +116,27 @@ PhaseFieldMicrostructure::PhaseFieldMicrostructure() : Integrator()
         {
             Util::Abort(INFO,"A GB model must be specified");
         }
+#if AMREX_SPACEDIM == 3
+        // The 3D anisotropy terms are written for the SH model only
+        if (anisotropy.on && gb_type != "sh") Util::Abort(INFO,"gb_type = sh is required in 3D, but got ",gb_type);
+#endif
+
+        pp.query("tabulate", anisotropy.tabulate);                       // Replace the GB model with a cubic Hermite lookup table
+        pp.query("tabulate_tolerance", anisotropy.tabulate_tolerance);   // Maximum interpolation error of the table (default 1E-6 in 2D, 1E-3 in 3D)
+        if (anisotropy.tabulate && gb_type != "")
+        {
+#if AMREX_SPACEDIM == 2
+            Model::Interface::GB::GB *model = boundary;
+            boundary = new Model::Interface::GB::Tabulated(*model, anisotropy.tabulate_tolerance);
+            delete model;
+#elif AMREX_SPACEDIM == 3
+            if (gb_type != "sh") Util::Abort(INFO,"Only the sh model can be tabulated in 3D");
+            boundary_table_sh = new Model::Interface::GB::TabulatedSH(*static_cast<Model::Interface::GB::SH *>(boundary),
+                                                                      anisotropy.tabulate_tolerance);
+            if (boundary_table_sh->Error() > anisotropy.tabulate_tolerance)
+                Util::Abort(INFO,"SH table error ",boundary_table_sh->Error()," exceeds anisotropy.tabulate_tolerance = ",anisotropy.tabulate_tolerance);
+#endif
+        }
     }
 
     {
@@ -158,9 +188,25 @@ PhaseFieldMicrostructure::PhaseFieldMicrostructure() : Integrator()
             Util::Abort(INFO, "No valid initial condition specified");
     }
 
-    eta_new_mf.resize(maxLevel() + 1);
-    RegisterNewFab(eta_new_mf, mybc, number_of_grains, number_of_ghost_cells, "Eta",true);
-    RegisterNewFab(eta_old_mf, mybc, number_of_grains, number_of_ghost_cells, "Eta old",false);
+    if (sparse.on)
+    {
+        // Written out as Eta001, Eta002, ... just like the dense field
+        sparse.eta_new.ncomp = number_of_grains;
+        sparse.eta_old.ncomp = number_of_grains;
+        RegisterGeneralFab(sparse.eta_new, 1, number_of_ghost_cells, "Eta", amrex::IndexType::TheCellType());
+        RegisterGeneralFab(sparse.eta_old, 1, number_of_ghost_cells, amrex::IndexType::TheCellType());
+        // Ghost cells at non-periodic boundaries are filled by zeroth-order
+        // extrapolation, which only agrees with homogeneous Neumann conditions
+        BC::Constant *bc_constant = dynamic_cast<BC::Constant *>(mybc);
+        if (!geom[0].isAllPeriodic() && !(bc_constant && bc_constant->IsHomogeneousNeumann()))
+            Util::Abort(INFO,"Sparse mode extrapolates Eta at non-periodic boundaries: bc.eta must be periodic or homogeneous Neumann");
+    }
+    else
+    {
+        eta_new_mf.resize(maxLevel() + 1);
+        RegisterNewFab(eta_new_mf, mybc, number_of_grains, number_of_ghost_cells, "Eta",true);
+        RegisterNewFab(eta_old_mf, mybc, number_of_grains, number_of_ghost_cells, "Eta old",false);
+    }
 
     volume = 1.0;
     RegisterIntegratedVariable(&volume, "volume");
@@ -207,165 +253,381 @@ PhaseFieldMicrostructure::PhaseFieldMicrostructure() : Integrator()
     }
 }
 
+PhaseFieldMicrostructure::~PhaseFieldMicrostructure()
+{
+#if AMREX_SPACEDIM == 3
+    delete boundary_table_sh;
+#endif
+}
+
 #define ETA(i, j, k, n) eta_old(amrex::IntVect(AMREX_D_DECL(i, j, k)), n)
 
+//
+// Helpers for sparse mode. Stencils are applied to one grain at a time,
+// gathered into a patch of radius at most 2 (the reach of DoubleHessian).
+//
+static constexpr int sparse_patch_size = AMREX_D_TERM(5,*5,*5);
+
+//
+// Collect the ids stored in the 3^d neighborhood of (i,j,k) into cand, in
+// ascending order, and return their number. Only these grains can have a
+// nonzero gradient at (i,j,k).
+//
+template<int K>
+AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+int SparseCandidates(amrex::Array4<const Set::SparseVector<K>> const &eta, int i, int j, int k, int *cand)
+{
+    int ncand = 0;
+    AMREX_D_TERM(for (int p = -1; p <= 1; p++),
+                 for (int q = -1; q <= 1; q++),
+                 for (int r = -1; r <= 1; r++))
+    {
+        const Set::SparseVector<K> &s = eta(i + p, j + AMREX_D_PICK(0,q,q), k + AMREX_D_PICK(0,0,r));
+        for (int b = 0; b < s.Size(); b++)
+        {
+            const int m = s.Id(b);
+            int c = ncand;
+            while (c > 0 && cand[c-1] > m) c--;
+            if (c > 0 && cand[c-1] == m) continue;
+            for (int d = ncand; d > c; d--) cand[d] = cand[d-1];
+            cand[c] = m;
+            ncand++;
+        }
+    }
+    return ncand;
+}
+
+//
+// Copy grain m in the (2r+1)^d patch around (i,j,k) into `patch` (of size
+// sparse_patch_size) and return it as a single-component array with the
+// same indexing as eta, so that the Numeric stencils apply unchanged.
+//
+template<int K>
+AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+amrex::Array4<const Set::Scalar> SparseGather(amrex::Array4<const Set::SparseVector<K>> const &eta,
+                                              int i, int j, int k, int m, int r, Set::Scalar *patch)
+{
+    const amrex::Dim3 lo = {i - r,     AMREX_D_PICK(j,     j - r,     j - r),     AMREX_D_PICK(k,     k,     k - r)};
+    const amrex::Dim3 hi = {i + r + 1, AMREX_D_PICK(j + 1, j + r + 1, j + r + 1), AMREX_D_PICK(k + 1, k + 1, k + r + 1)};
+    amrex::Array4<Set::Scalar> a(patch, lo, hi, 1);
+    for (int kk = lo.z; kk < hi.z; kk++)
+        for (int jj = lo.y; jj < hi.y; jj++)
+            for (int ii = lo.x; ii < hi.x; ii++)
+                a(ii,jj,kk) = eta(ii,jj,kk)(m);
+    return a;
+}
+
 void PhaseFieldMicrostructure::Advance(int lev, amrex::Real time, amrex::Real dt)
 {
     BL_PROFILE("PhaseFieldMicrostructure::Advance");
     /// TODO Make this optional
     //if (lev != max_level) return;
-    std::swap(eta_old_mf[lev], eta_new_mf[lev]);
+    if (sparse.on) std::swap(sparse.eta_old[lev], sparse.eta_new[lev]);
+    else std::swap(eta_old_mf[lev], eta_new_mf[lev]);
     const amrex::Real *DX = geom[lev].CellSize();
 
-    Model::Interface::GB::SH gbmodel(0.0, 0.0, anisotropy.sigma0, anisotropy.sigma1);
+    // The parsed SH model; the table, if any, is built from the same object
+    Model::Interface::GB::SH gbmodel = BoundarySH();
 
-    for (amrex::MFIter mfi(*eta_new_mf[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    //
+    // Boundary term for grain m of eta, shared by the dense and sparse
+    // paths. Returns false if the grain is too flat to evolve at (i,j,k);
+    // otherwise adds to driving_force and sets the chemical potential
+    // prefactor mu.
+    //
+    auto boundary_force = [=] AMREX_GPU_DEVICE (amrex::Array4<const Set::Scalar> const &eta,
+                                                int i, int j, int k, int m,
+                                                Set::Scalar &driving_force, Set::Scalar &mu) -> bool
     {
-        const amrex::Box &bx = mfi.tilebox();
-        amrex::Array4<const amrex::Real> const &eta = (*eta_old_mf[lev]).array(mfi);
-        amrex::Array4<amrex::Real> const &etanew = (*eta_new_mf[lev]).array(mfi);
-        
-        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
-                                    for (int m = 0; m < number_of_grains; m++)
-                                    {
-                                        Set::Scalar driving_force = 0.0;
-
-                                        Set::Scalar kappa = NAN, mu = NAN;
+        Set::Scalar kappa = NAN;
 
-                                        //
-                                        // BOUNDARY TERM and SECOND ORDER REGULARIZATION
-                                        //
+        //
+        // BOUNDARY TERM and SECOND ORDER REGULARIZATION
+        //
 
-                                        Set::Vector Deta = Numeric::Gradient(eta, i, j, k, m, DX);
-                                        Set::Scalar normgrad = Deta.lpNorm<2>();
-                                        if (normgrad < 1E-4)
-                                            continue; // This ought to speed things up.
+        Set::Vector Deta = Numeric::Gradient(eta, i, j, k, m, DX);
+        Set::Scalar normgrad = Deta.lpNorm<2>();
+        if (normgrad < 1E-4)
+            return false; // This ought to speed things up.
 
-                                        Set::Matrix DDeta = Numeric::Hessian(eta, i, j, k, m, DX);
-                                        Set::Scalar laplacian = DDeta.trace();
+        Set::Matrix DDeta = Numeric::Hessian(eta, i, j, k, m, DX);
+        Set::Scalar laplacian = DDeta.trace();
 
-                                        if (!anisotropy.on || time < anisotropy.tstart)
-                                        {
-                                            kappa = pf.l_gb * 0.75 * pf.sigma0;
-                                            mu = 0.75 * (1.0 / 0.23) * pf.sigma0 / pf.l_gb;
-                                            driving_force += -kappa * laplacian;
-                                        }
-                                        else
-                                        {
-                                            Set::Vector normal = Deta / normgrad;
-                                            Set::Matrix4<AMREX_SPACEDIM, Set::Sym::Full> DDDDEta = Numeric::DoubleHessian<AMREX_SPACEDIM>(eta, i, j, k, m, DX);
+        if (!anisotropy.on || time < anisotropy.tstart)
+        {
+            kappa = pf.l_gb * 0.75 * pf.sigma0;
+            mu = 0.75 * (1.0 / 0.23) * pf.sigma0 / pf.l_gb;
+            driving_force += -kappa * laplacian;
+        }
+        else
+        {
+            Set::Vector normal = Deta / normgrad;
+            Set::Matrix4<AMREX_SPACEDIM, Set::Sym::Full> DDDDEta = Numeric::DoubleHessian<AMREX_SPACEDIM>(eta, i, j, k, m, DX);
 
 #if AMREX_SPACEDIM == 1
-                                            Util::Abort(INFO, "Anisotropy is enabled but works in 2D/3D ONLY");
+            Util::Abort(INFO, "Anisotropy is enabled but works in 2D/3D ONLY");
 #elif AMREX_SPACEDIM == 2
-                                            Set::Vector tangent(normal[1],-normal[0]);
-                                            Set::Scalar Theta = atan2(Deta(1),Deta(0));
-                                            Set::Scalar kappa = pf.l_gb*0.75*boundary->W(Theta);
-                                            Set::Scalar Dkappa = pf.l_gb*0.75*boundary->DW(Theta);
-                                            Set::Scalar DDkappa = pf.l_gb*0.75*boundary->DDW(Theta);
-                                            mu = 0.75 * (1.0/0.23) * boundary->W(Theta) / pf.l_gb;
-                                            Set::Scalar sinTheta = sin(Theta);
-                                            Set::Scalar cosTheta = cos(Theta);
-            
-                                            Set::Scalar Curvature_term =
-                                                DDDDEta(0,0,0,0)*(    sinTheta*sinTheta*sinTheta*sinTheta) +
-                                                DDDDEta(0,0,0,1)*(4.0*sinTheta*sinTheta*sinTheta*cosTheta) +
-                                                DDDDEta(0,0,1,1)*(6.0*sinTheta*sinTheta*cosTheta*cosTheta) +
-                                                DDDDEta(0,1,1,1)*(4.0*sinTheta*cosTheta*cosTheta*cosTheta) +
-                                                DDDDEta(1,1,1,1)*(    cosTheta*cosTheta*cosTheta*cosTheta);
-
-                                            Set::Scalar Boundary_term =
-                                                kappa*laplacian +
-                                                Dkappa*(cos(2.0*Theta)*DDeta(0,1) + 0.5*sin(2.0*Theta)*(DDeta(1,1) - DDeta(0,0)))
-                                                + 0.5*DDkappa*(sinTheta*sinTheta*DDeta(0,0) - 2.*sinTheta*cosTheta*DDeta(0,1) + cosTheta*cosTheta*DDeta(1,1));
-                                            if (std::isnan(Boundary_term)) Util::Abort(INFO,"nan at m=",i,",",j,",",k);
-            
-                                            driving_force += - (Boundary_term) + anisotropy.beta*(Curvature_term);
-                                            if (std::isnan(driving_force)) Util::Abort(INFO,"nan at m=",i,",",j,",",k);
+            Set::Vector tangent(normal[1],-normal[0]);
+            Set::Scalar Theta = atan2(Deta(1),Deta(0));
+            Set::Scalar kappa = pf.l_gb*0.75*boundary->W(Theta);
+            Set::Scalar Dkappa = pf.l_gb*0.75*boundary->DW(Theta);
+            Set::Scalar DDkappa = pf.l_gb*0.75*boundary->DDW(Theta);
+            mu = 0.75 * (1.0/0.23) * boundary->W(Theta) / pf.l_gb;
+            Set::Scalar sinTheta = sin(Theta);
+            Set::Scalar cosTheta = cos(Theta);
+
+            Set::Scalar Curvature_term =
+                DDDDEta(0,0,0,0)*(    sinTheta*sinTheta*sinTheta*sinTheta) +
+                DDDDEta(0,0,0,1)*(4.0*sinTheta*sinTheta*sinTheta*cosTheta) +
+                DDDDEta(0,0,1,1)*(6.0*sinTheta*sinTheta*cosTheta*cosTheta) +
+                DDDDEta(0,1,1,1)*(4.0*sinTheta*cosTheta*cosTheta*cosTheta) +
+                DDDDEta(1,1,1,1)*(    cosTheta*cosTheta*cosTheta*cosTheta);
+
+            Set::Scalar Boundary_term =
+                kappa*laplacian +
+                Dkappa*(cos(2.0*Theta)*DDeta(0,1) + 0.5*sin(2.0*Theta)*(DDeta(1,1) - DDeta(0,0)))
+                + 0.5*DDkappa*(sinTheta*sinTheta*DDeta(0,0) - 2.*sinTheta*cosTheta*DDeta(0,1) + cosTheta*cosTheta*DDeta(1,1));
+            if (std::isnan(Boundary_term)) Util::Abort(INFO,"nan at m=",i,",",j,",",k);
+
+            driving_force += - (Boundary_term) + anisotropy.beta*(Curvature_term);
+            if (std::isnan(driving_force)) Util::Abort(INFO,"nan at m=",i,",",j,",",k);
 
 #elif AMREX_SPACEDIM == 3
-                                            // GRAHM-SCHMIDT PROCESS 
-                                            const Set::Vector e1(1,0,0), e2(0,1,0), e3(0,0,1);
-                                            Set::Vector _t2, _t3;
-                                            if      (fabs(normal(0)) > fabs(normal(1)) && fabs(normal(0)) > fabs(normal(2)))
-                                            {
-                                                _t2 = e2 - normal.dot(e2)*normal; _t2 /= _t2.lpNorm<2>();
-                                                _t3 = e3 - normal.dot(e3)*normal - _t2.dot(e3)*_t2; _t3 /= _t3.lpNorm<2>();
-                                            }
-                                            else if (fabs(normal(1)) > fabs(normal(0)) && fabs(normal(1)) > fabs(normal(2)))
-                                            {
-                                                _t2 = e1 - normal.dot(e1)*normal; _t2 /= _t2.lpNorm<2>();
-                                                _t3 = e3 - normal.dot(e3)*normal - _t2.dot(e3)*_t2; _t3 /= _t3.lpNorm<2>();
-                                            }
-                                            else
-                                            {
-                                                _t2 = e1 - normal.dot(e1)*normal; _t2 /= _t2.lpNorm<2>();
-                                                _t3 = e2 - normal.dot(e2)*normal - _t2.dot(e2)*_t2; _t3 /= _t3.lpNorm<2>();
-                                            }
-                                                
-                                            // Compute Hessian projected into tangent space (spanned by _t1,_t2)
-                                            Eigen::Matrix2d DDeta2D;
-                                            DDeta2D <<
-                                                _t2.dot(DDeta*_t2) , _t2.dot(DDeta*_t3),
-                                                _t3.dot(DDeta*_t2) , _t3.dot(DDeta*_t3);
-                                            Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> eigensolver(2);
-                                            eigensolver.computeDirect(DDeta2D);
-                                            Eigen::Matrix2d eigenvecs = eigensolver.eigenvectors();
-
-                                            // Compute tangent vectors embedded in R^3
-                                            Set::Vector t2 = _t2*eigenvecs(0,0) + _t3*eigenvecs(0,1),
-                                                t3 = _t2*eigenvecs(1,0) + _t3*eigenvecs(1,1);
-
-                                            // Compute components of second Hessian in t2,t3 directions
-                                            Set::Scalar DH2 = 0.0, DH3 = 0.0;
-                                            Set::Scalar DH23 = 0.0;
-                                            for (int p = 0; p < 3; p++)
-                                                for (int q = 0; q < 3; q++)
-                                                    for (int r = 0; r < 3; r++)
-                                                        for (int s = 0; s < 3; s++)
-                                                        {
-                                                            DH2 += DDDDEta(p,q,r,s)*t2(p)*t2(q)*t2(r)*t2(s);
-                                                            DH3 += DDDDEta(p,q,r,s)*t3(p)*t3(q)*t3(r)*t3(s);
-                                                            DH23 += DDDDEta(p,q,r,s)*t2(p)*t2(q)*t3(r)*t3(s);
-                                                        }
-
-                                            Set::Scalar gbe = gbmodel.W(normal);
-                                            //Set::Scalar kappa = l_gb*0.75*gbe;
-                                            kappa = pf.l_gb*0.75*gbe;
-                                            mu = 0.75 * (1.0/0.23) * gbe / pf.l_gb;
-                                            Set::Scalar DDK2 = gbmodel.DDW(normal,_t2) * pf.l_gb * 0.75;
-                                            Set::Scalar DDK3 = gbmodel.DDW(normal,_t3) * pf.l_gb * 0.75;
-
-                                            // GB energy anisotropy term
-                                            Set::Scalar gbenergy_df = - kappa*laplacian - DDK2*DDeta2D(0,0) - DDK3*DDeta2D(1,1);
-                                            driving_force += gbenergy_df;
-                                  
-                                            // Second order curvature term
-                                            Set::Scalar reg_df = NAN;
-                                            switch(regularization)
-                                            {
-                                            case Wilmore:
-                                                reg_df = anisotropy.beta*(DH2 + DH3 + 2.0*DH23);
-                                                break;
-                                            case K12:
-                                                reg_df = anisotropy.beta*(DH2+DH3);
-                                                break;
-                                            }
-                                            driving_force += reg_df;
-
-                                            if (std::isnan(driving_force) || std::isinf(driving_force))
-                                            {
-                                                for (int p = 0; p < 3; p++)
-                                                    for (int q = 0; q < 3; q++)
-                                                        for (int r = 0; r < 3; r++)
-                                                            for (int s = 0; s < 3; s++)
-                                                            {
-                                                                Util::Message(INFO,p,q,r,s," ",DDDDEta(p,q,r,s));
-                                                            }
-                                                Util::Abort(INFO,"nan/inf detected at amrlev = ", lev," i=",i," j=",j," k=",k);
-                                            }
+            // GRAHM-SCHMIDT PROCESS 
+            const Set::Vector e1(1,0,0), e2(0,1,0), e3(0,0,1);
+            Set::Vector _t2, _t3;
+            if      (fabs(normal(0)) > fabs(normal(1)) && fabs(normal(0)) > fabs(normal(2)))
+            {
+                _t2 = e2 - normal.dot(e2)*normal; _t2 /= _t2.lpNorm<2>();
+                _t3 = e3 - normal.dot(e3)*normal - _t2.dot(e3)*_t2; _t3 /= _t3.lpNorm<2>();
+            }
+            else if (fabs(normal(1)) > fabs(normal(0)) && fabs(normal(1)) > fabs(normal(2)))
+            {
+                _t2 = e1 - normal.dot(e1)*normal; _t2 /= _t2.lpNorm<2>();
+                _t3 = e3 - normal.dot(e3)*normal - _t2.dot(e3)*_t2; _t3 /= _t3.lpNorm<2>();
+            }
+            else
+            {
+                _t2 = e1 - normal.dot(e1)*normal; _t2 /= _t2.lpNorm<2>();
+                _t3 = e2 - normal.dot(e2)*normal - _t2.dot(e2)*_t2; _t3 /= _t3.lpNorm<2>();
+            }
+                
+            // Compute Hessian projected into tangent space (spanned by _t1,_t2)
+            Eigen::Matrix2d DDeta2D;
+            DDeta2D <<
+                _t2.dot(DDeta*_t2) , _t2.dot(DDeta*_t3),
+                _t3.dot(DDeta*_t2) , _t3.dot(DDeta*_t3);
+            Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> eigensolver(2);
+            eigensolver.computeDirect(DDeta2D);
+            Eigen::Matrix2d eigenvecs = eigensolver.eigenvectors();
+
+            // Compute tangent vectors embedded in R^3
+            Set::Vector t2 = _t2*eigenvecs(0,0) + _t3*eigenvecs(0,1),
+                t3 = _t2*eigenvecs(1,0) + _t3*eigenvecs(1,1);
+
+            // Compute components of second Hessian in t2,t3 directions
+            Set::Scalar DH2 = 0.0, DH3 = 0.0;
+            Set::Scalar DH23 = 0.0;
+            for (int p = 0; p < 3; p++)
+                for (int q = 0; q < 3; q++)
+                    for (int r = 0; r < 3; r++)
+                        for (int s = 0; s < 3; s++)
+                        {
+                            DH2 += DDDDEta(p,q,r,s)*t2(p)*t2(q)*t2(r)*t2(s);
+                            DH3 += DDDDEta(p,q,r,s)*t3(p)*t3(q)*t3(r)*t3(s);
+                            DH23 += DDDDEta(p,q,r,s)*t2(p)*t2(q)*t3(r)*t3(s);
+                        }
+
+            Set::Scalar gbe = boundary_table_sh ? boundary_table_sh->W(normal) : gbmodel.W(normal);
+            //Set::Scalar kappa = l_gb*0.75*gbe;
+            kappa = pf.l_gb*0.75*gbe;
+            mu = 0.75 * (1.0/0.23) * gbe / pf.l_gb;
+            Set::Scalar DDK2 = (boundary_table_sh ? boundary_table_sh->DDW(normal,_t2) : gbmodel.DDW(normal,_t2)) * pf.l_gb * 0.75;
+            Set::Scalar DDK3 = (boundary_table_sh ? boundary_table_sh->DDW(normal,_t3) : gbmodel.DDW(normal,_t3)) * pf.l_gb * 0.75;
+
+            // GB energy anisotropy term
+            Set::Scalar gbenergy_df = - kappa*laplacian - DDK2*DDeta2D(0,0) - DDK3*DDeta2D(1,1);
+            driving_force += gbenergy_df;
+  
+            // Second order curvature term
+            Set::Scalar reg_df = NAN;
+            switch(regularization)
+            {
+            case Wilmore:
+                reg_df = anisotropy.beta*(DH2 + DH3 + 2.0*DH23);
+                break;
+            case K12:
+                reg_df = anisotropy.beta*(DH2+DH3);
+                break;
+            }
+            driving_force += reg_df;
+
+            if (std::isnan(driving_force) || std::isinf(driving_force))
+            {
+                for (int p = 0; p < 3; p++)
+                    for (int q = 0; q < 3; q++)
+                        for (int r = 0; r < 3; r++)
+                            for (int s = 0; s < 3; s++)
+                            {
+                                Util::Message(INFO,p,q,r,s," ",DDDDEta(p,q,r,s));
+                            }
+                Util::Abort(INFO,"nan/inf detected at amrlev = ", lev," i=",i," j=",j," k=",k);
+            }
 #endif
-                                        }
+        }
+        return true;
+    };
+
+    //
+    // ELASTIC DRIVING FORCE for grain m, given the stress sig at the cell
+    //
+    const bool elastic_on = elastic.on && time > elastic.tstart;
+    auto elastic_force = [=] AMREX_GPU_DEVICE (const Set::Matrix &sig, int m) -> Set::Scalar
+    {
+        Set::Scalar driving_force = 0.0;
+
+        Set::Matrix dF0deta = elastic.model[m].F0;//(etasum * elastic.model[m].F0 - F0avg) / (etasum * etasum);
+
+        Set::Scalar tmpdf = (dF0deta.transpose() * sig).trace();
+
+        if (tmpdf > pf.elastic_threshold)
+        {
+            driving_force -= pf.elastic_mult * (tmpdf-pf.elastic_threshold);
+        }
+        else if (tmpdf < -pf.elastic_threshold)
+        {
+            driving_force -= pf.elastic_mult * (tmpdf+pf.elastic_threshold);
+        }
+        return driving_force;
+    };
+    auto cell_stress = [=] AMREX_GPU_DEVICE (amrex::Array4<const Set::Scalar> const &sigma, int i, int j, int k) -> Set::Matrix
+    {
+        Set::Matrix sig;
+#if AMREX_SPACEDIM == 2
+        sig(0,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,0);
+        sig(0,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,1);
+        sig(1,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,2);
+        sig(1,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,3);
+#elif AMREX_SPACEDIM == 3
+        sig(0,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,0);
+        sig(0,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,1);
+        sig(0,2) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,2);
+        sig(1,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,3);
+        sig(1,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,4);
+        sig(1,2) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,5);
+        sig(2,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,6);
+        sig(2,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,7);
+        sig(2,2) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,8);
+#endif
+        return sig;
+    };
+
+    if (sparse.on)
+    {
+        //
+        // Only the candidate grains of each cell are evolved. Their values
+        // are appended in ascending order of id, so no sorting is needed.
+        //
+        const Set::Scalar threshold = sparse.threshold;
+        const int capacity = sparse.capacity;
+        const int radius = anisotropy.on ? 2 : 1;
+        int overflow = 0;
+        for (amrex::MFIter mfi(*sparse.eta_new[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const amrex::Box &bx = mfi.tilebox();
+            amrex::Array4<const sparse_type> const &eta = sparse.eta_old[lev]->const_array(mfi);
+            amrex::Array4<sparse_type> const &etanew = sparse.eta_new[lev]->array(mfi);
+            amrex::Array4<const Set::Scalar> sigma;
+            if (elastic_on) sigma = stress_mf[lev]->const_array(mfi);
+
+            amrex::ReduceOps<amrex::ReduceOpSum> reduce_op;
+            amrex::ReduceData<int> reduce_data(reduce_op);
+            using ReduceTuple = typename decltype(reduce_data)::Type;
+            reduce_op.eval(bx, reduce_data, [=] AMREX_GPU_DEVICE(int i, int j, int k) -> ReduceTuple
+            {
+                const sparse_type &here = eta(i, j, k);
+                // Values from two steps ago: as in the dense path, grains
+                // that are too flat to evolve keep these.
+                const sparse_type stale = etanew(i, j, k);
+
+                int cand[AMREX_D_TERM(3,*3,*3)*sparse_max_capacity];
+                const int ncand = SparseCandidates(eta, i, j, k, cand);
+
+                Set::Matrix sig;
+                if (elastic_on) sig = cell_stress(sigma, i, j, k);
+
+                sparse_type result;
+                int dropped = 0;
+                for (int c = 0; c < ncand; c++)
+                {
+                    const int m = cand[c];
+                    Set::Scalar patch[sparse_patch_size];
+                    amrex::Array4<const Set::Scalar> etam = SparseGather(eta, i, j, k, m, radius, patch);
+
+                    Set::Scalar driving_force = 0.0, mu = NAN;
+                    Set::Scalar val;
+                    if (boundary_force(etam, i, j, k, 0, driving_force, mu))
+                    {
+                        //
+                        // CHEMICAL POTENTIAL
+                        //
+                        const Set::Scalar eta_m = here(m);
+                        Set::Scalar sum_of_squares = 0.;
+                        for (int b = 0; b < here.Size(); b++)
+                        {
+                            if (here.Id(b) == m)
+                                continue;
+                            sum_of_squares += here.Value(b) * here.Value(b);
+                        }
+                        driving_force += mu * (eta_m * eta_m - 1.0 + 2.0 * pf.gamma * sum_of_squares) * eta_m;
+
+                        //
+                        // SYNTHETIC DRIVING FORCE
+                        //
+                        if (lagrange.on && m == 0 && time > lagrange.tstart)
+                        {
+                            driving_force += lagrange.lambda * (volume - lagrange.vol0);
+                        }
+
+                        //
+                        // EVOLVE ETA
+                        //
+                        val = eta_m - pf.L * dt * driving_force;
+                        if (std::isnan(driving_force))
+                            Util::Abort(INFO, i, " ", j, " ", k, " ", m);
+                    }
+                    else val = stale(m);
+
+                    if (elastic_on) val -= pf.L * dt * elastic_force(sig, m);
+
+                    if (std::fabs(val) > threshold)
+                    {
+                        if (result.Size() < capacity) result.Append(m, val);
+                        else dropped++;
+                    }
+                }
+                etanew(i, j, k) = result;
+                return {dropped};
+            });
+            overflow += amrex::get<0>(reduce_data.value());
+        }
+        amrex::ParallelDescriptor::ReduceIntSum(overflow);
+        if (overflow) Util::Abort(INFO,"More than pf.sparse.capacity = ",sparse.capacity," grains in ",overflow," cells on level ",lev);
+        return;
+    }
+
+    for (amrex::MFIter mfi(*eta_new_mf[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const amrex::Box &bx = mfi.tilebox();
+        amrex::Array4<const amrex::Real> const &eta = (*eta_old_mf[lev]).array(mfi);
+        amrex::Array4<amrex::Real> const &etanew = (*eta_new_mf[lev]).array(mfi);
+        
+        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                                    for (int m = 0; m < number_of_grains; m++)
+                                    {
+                                        Set::Scalar driving_force = 0.0, mu = NAN;
+                                        if (!boundary_force(eta, i, j, k, m, driving_force, mu))
+                                            continue;
 
                                         //
                                         // CHEMICAL POTENTIAL
@@ -400,61 +662,15 @@ void PhaseFieldMicrostructure::Advance(int lev, amrex::Real time, amrex::Real dt
         //
         // ELASTIC DRIVING FORCE
         //
-        if (elastic.on && time > elastic.tstart)
+        if (elastic_on)
         {
-            const amrex::Box &bx = mfi.tilebox();
-            amrex::Array4<const amrex::Real> const &eta = (*eta_old_mf[lev]).array(mfi);
-            amrex::Array4<amrex::Real> const &etanew = (*eta_new_mf[lev]).array(mfi);
             amrex::Array4<const amrex::Real> const &sigma = (*stress_mf[lev]).array(mfi);
 
             amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) 
                                     {
+                                        Set::Matrix sig = cell_stress(sigma, i, j, k);
                                         for (int m = 0; m < number_of_grains; m++)
-                                        {
-                                            Set::Scalar driving_force = 0.0;
-                                            Set::Scalar etasum = 0.0;
-                                            Set::Matrix F0avg = Set::Matrix::Zero();
-                    
-                                            for (int n = 0; n < number_of_grains; n++)
-                                            {
-                                                etasum += eta(i,j,k,n);
-                                                F0avg  += eta(i,j,k,n) * elastic.model[n].F0;
-                                            } 
-                    
-                                            Set::Matrix dF0deta = elastic.model[m].F0;//(etasum * elastic.model[m].F0 - F0avg) / (etasum * etasum);
-
-
-                                            Set::Matrix sig;
-#if AMREX_SPACEDIM == 2
-                                            sig(0,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,0);
-                                            sig(0,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,1);
-                                            sig(1,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,2);
-                                            sig(1,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,3);
-#elif AMREX_SPACEDIM == 3
-                                            sig(0,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,0);
-                                            sig(0,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,1);
-                                            sig(0,2) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,2);
-                                            sig(1,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,3);
-                                            sig(1,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,4);
-                                            sig(1,2) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,5);
-                                            sig(2,0) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,6);
-                                            sig(2,1) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,7);
-                                            sig(2,2) = Numeric::Interpolate::CellToNodeAverage(sigma,i,j,k,8);
-#endif
-
-                                            Set::Scalar tmpdf = (dF0deta.transpose() * sig).trace();
-
-                                            if (tmpdf > pf.elastic_threshold)
-                                            {
-                                                driving_force -= pf.elastic_mult * (tmpdf-pf.elastic_threshold);
-                                            }
-                                            else if (tmpdf < -pf.elastic_threshold)
-                                            {
-                                                driving_force -= pf.elastic_mult * (tmpdf+pf.elastic_threshold);
-                                            }
-
-                                            etanew(i, j, k, m) -= pf.L * dt * driving_force;
-                                        }
+                                            etanew(i, j, k, m) -= pf.L * dt * elastic_force(sig, m);
                                     });
 
         }
@@ -464,11 +680,56 @@ void PhaseFieldMicrostructure::Advance(int lev, amrex::Real time, amrex::Real dt
 void PhaseFieldMicrostructure::Initialize(int lev)
 {
     BL_PROFILE("PhaseFieldMicrostructure::Initialize");
-    eta_new_mf[lev]->setVal(0.0);
-    eta_old_mf[lev]->setVal(0.0);
+    if (sparse.on)
+    {
+        // Initialize a dense field and keep the values above threshold
+        const amrex::BoxArray &ba = sparse.eta_new[lev]->boxArray();
+        const amrex::DistributionMapping &dm = sparse.eta_new[lev]->DistributionMap();
+        Set::Field<Set::Scalar> dense(lev + 1);
+        dense.Define(lev, ba, dm, number_of_grains, number_of_ghost_cells);
+        ic->Initialize(lev, dense);
+
+        const int N = number_of_grains;
+        const Set::Scalar threshold = sparse.threshold;
+        const int capacity = sparse.capacity;
+        int overflow = 0;
+        for (amrex::MFIter mfi(*dense[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const amrex::Box &bx = mfi.growntilebox();
+            amrex::Array4<const Set::Scalar> const &eta = dense[lev]->const_array(mfi);
+            amrex::Array4<sparse_type> const &etanew = sparse.eta_new[lev]->array(mfi);
+            amrex::Array4<sparse_type> const &etaold = sparse.eta_old[lev]->array(mfi);
+
+            amrex::ReduceOps<amrex::ReduceOpSum> reduce_op;
+            amrex::ReduceData<int> reduce_data(reduce_op);
+            using ReduceTuple = typename decltype(reduce_data)::Type;
+            reduce_op.eval(bx, reduce_data, [=] AMREX_GPU_DEVICE(int i, int j, int k) -> ReduceTuple
+            {
+                sparse_type s;
+                int dropped = 0;
+                for (int n = 0; n < N; n++)
+                {
+                    if (std::fabs(eta(i,j,k,n)) <= threshold) continue;
+                    if (s.Size() < capacity) s.Append(n, eta(i,j,k,n));
+                    else dropped++;
+                }
+                etanew(i,j,k) = s;
+                etaold(i,j,k) = s;
+                return {dropped};
+            });
+            overflow += amrex::get<0>(reduce_data.value());
+        }
+        amrex::ParallelDescriptor::ReduceIntSum(overflow);
+        if (overflow) Util::Abort(INFO,"The initial condition has more than pf.sparse.capacity = ",sparse.capacity," grains in ",overflow," cells on level ",lev);
+    }
+    else
+    {
+        eta_new_mf[lev]->setVal(0.0);
+        eta_old_mf[lev]->setVal(0.0);
 
-    ic->Initialize(lev, eta_new_mf);
-    ic->Initialize(lev, eta_old_mf);
+        ic->Initialize(lev, eta_new_mf);
+        ic->Initialize(lev, eta_old_mf);
+    }
 
     if (elastic.on)
     {
@@ -485,8 +746,36 @@ void PhaseFieldMicrostructure::TagCellsForRefinement(int lev, amrex::TagBoxArray
     const Set::Vector dx(DX);
     const Set::Scalar dxnorm = dx.lpNorm<2>();
 
+    if (sparse.on)
+    {
+        for (amrex::MFIter mfi(*sparse.eta_new[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            if (!InTagBand(lev, mfi)) continue;
+            const amrex::Box &bx = mfi.tilebox();
+            amrex::Array4<const sparse_type> const &etanew = sparse.eta_new[lev]->const_array(mfi);
+            amrex::Array4<char> const &tags = a_tags.array(mfi);
+
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                int cand[AMREX_D_TERM(3,*3,*3)*sparse_max_capacity];
+                const int ncand = SparseCandidates(etanew, i, j, k, cand);
+                for (int c = 0; c < ncand; c++)
+                {
+                    Set::Scalar patch[sparse_patch_size];
+                    Set::Vector grad = Numeric::Gradient(SparseGather(etanew, i, j, k, cand[c], 1, patch), i, j, k, 0, DX);
+                    if (dxnorm * grad.lpNorm<2>() > ref_threshold)
+                    {
+                        tags(i, j, k) = amrex::TagBox::SET;
+                        return;
+                    }
+                }
+            });
+        }
+        return;
+    }
+
     for (amrex::MFIter mfi(*eta_new_mf[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
     {
+        if (!InTagBand(lev, mfi)) continue;
         const amrex::Box &bx = mfi.tilebox();
         amrex::Array4<const amrex::Real> const &etanew = (*eta_new_mf[lev]).array(mfi);
         amrex::Array4<char> const &tags = a_tags.array(mfi);
@@ -501,6 +790,59 @@ void PhaseFieldMicrostructure::TagCellsForRefinement(int lev, amrex::TagBoxArray
     }
 }
 
+void PhaseFieldMicrostructure::EstimateCost(int lev, amrex::LayoutData<Set::Scalar> &cost)
+{
+    BL_PROFILE("PhaseFieldMicrostructure::EstimateCost");
+    const amrex::Real *DX = geom[lev].CellSize();
+    const int ngrains = number_of_grains;
+
+    if (sparse.on)
+    {
+        for (amrex::MFIter mfi(*sparse.eta_new[lev], false); mfi.isValid(); ++mfi)
+        {
+            const amrex::Box &bx = mfi.validbox();
+            amrex::Array4<const sparse_type> const &eta = sparse.eta_new[lev]->const_array(mfi);
+
+            amrex::ReduceOps<amrex::ReduceOpSum> reduce_op;
+            amrex::ReduceData<Set::Scalar> reduce_data(reduce_op);
+            using ReduceTuple = typename decltype(reduce_data)::Type;
+            reduce_op.eval(bx, reduce_data, [=] AMREX_GPU_DEVICE(int i, int j, int k) -> ReduceTuple
+            {
+                int cand[AMREX_D_TERM(3,*3,*3)*sparse_max_capacity];
+                const int ncand = SparseCandidates(eta, i, j, k, cand);
+                Set::Scalar c = 1.0;
+                for (int a = 0; a < ncand; a++)
+                {
+                    Set::Scalar patch[sparse_patch_size];
+                    if (Numeric::Gradient(SparseGather(eta, i, j, k, cand[a], 1, patch), i, j, k, 0, DX).lpNorm<2>() >= 1E-4) c += 1.0;
+                }
+                return {c};
+            });
+            cost[mfi] = amrex::get<0>(reduce_data.value());
+        }
+        return;
+    }
+
+    for (amrex::MFIter mfi(*eta_new_mf[lev], false); mfi.isValid(); ++mfi)
+    {
+        const amrex::Box &bx = mfi.validbox();
+        amrex::Array4<const amrex::Real> const &eta = (*eta_new_mf[lev]).const_array(mfi);
+
+        amrex::ReduceOps<amrex::ReduceOpSum> reduce_op;
+        amrex::ReduceData<Set::Scalar> reduce_data(reduce_op);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+        reduce_op.eval(bx, reduce_data, [=] AMREX_GPU_DEVICE(int i, int j, int k) -> ReduceTuple
+        {
+            // Same cutoff as in Advance
+            Set::Scalar c = 1.0;
+            for (int m = 0; m < ngrains; m++)
+                if (Numeric::Gradient(eta, i, j, k, m, DX).lpNorm<2>() >= 1E-4) c += 1.0;
+            return {c};
+        });
+        cost[mfi] = amrex::get<0>(reduce_data.value());
+    }
+}
+
 void PhaseFieldMicrostructure::TimeStepComplete(amrex::Real /*time*/, int /*iter*/)
 {
     // TODO: remove this function, it is no longer needed.
@@ -539,7 +881,8 @@ void PhaseFieldMicrostructure::TimeStepBegin(amrex::Real time, int iter)
         amrex::Box domain(geom[lev].Domain());
         domain.convert(amrex::IntVect::TheNodeVector());
 
-        eta_new_mf[lev]->FillBoundary();
+        if (sparse.on) Util::RealFillBoundary(*sparse.eta_new[lev],geom[lev]);
+        else eta_new_mf[lev]->FillBoundary();
 
         Set::Vector DX(geom[lev].CellSize());
 
@@ -548,6 +891,16 @@ void PhaseFieldMicrostructure::TimeStepBegin(amrex::Real time, int iter)
             amrex::Box bx = mfi.grownnodaltilebox();//-1,2);
 
             amrex::Array4<model_type> const &model = model_mf[lev]->array(mfi);
+            if (sparse.on)
+            {
+                amrex::Array4<const sparse_type> const &eta = sparse.eta_new[lev]->const_array(mfi);
+                amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                                            std::vector<Set::Scalar> etas(number_of_grains);
+                                            for (int n = 0; n < number_of_grains; n++) etas[n] = 0.25*(eta(i,j,k)(n) + eta(i,j-1,k)(n) + eta(i-1,j,k)(n) + eta(i-1,j-1,k)(n));
+                                            model(i, j, k) = model_type::Combine(elastic.model,etas);
+                                        });
+                continue;
+            }
             amrex::Array4<const Set::Scalar> const &eta = eta_new_mf[lev]->array(mfi);
 
             amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
@@ -574,71 +927,88 @@ void PhaseFieldMicrostructure::TimeStepBegin(amrex::Real time, int iter)
 }
 
 void PhaseFieldMicrostructure::Integrate(int amrlev, Set::Scalar time, int /*step*/,
-                                        const amrex::MFIter &mfi, const amrex::Box &box)
+                                        const amrex::MFIter &mfi, const amrex::Box &box,
+                                        const ThermoSum &sum)
 {
     BL_PROFILE("PhaseFieldMicrostructure::Integrate");
 
-    Model::Interface::GB::SH gbmodel(0.0, 0.0, anisotropy.sigma0, anisotropy.sigma1);
+    // The parsed SH model; the table, if any, is built from the same object
+    Model::Interface::GB::SH gbmodel = BoundarySH();
     const amrex::Real *DX = geom[amrlev].CellSize();
     Set::Scalar dv = AMREX_D_TERM(DX[0], *DX[1], *DX[2]);
 
     BL_PROFILE("PhaseFieldMicrostructure::Integrate");
-    amrex::Array4<amrex::Real> const &eta = (*eta_new_mf[amrlev]).array(mfi);
-    amrex::ParallelFor(box, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
-
-                                volume += eta(i, j, k, 0) * dv;
+    auto volume_sum = sum(volume), area_sum = sum(area), gbenergy_sum = sum(gbenergy);
+    auto realgbenergy_sum = sum(realgbenergy), regenergy_sum = sum(regenergy);
+    auto integrate = [=] AMREX_GPU_DEVICE(amrex::Array4<const Set::Scalar> const &eta, int i, int j, int k) {
+        volume_sum += eta(i, j, k, 0) * dv;
 
-                                Set::Vector grad = Numeric::Gradient(eta, i, j, k, 0, DX);
-                                Set::Scalar normgrad = grad.lpNorm<2>();
+        Set::Vector grad = Numeric::Gradient(eta, i, j, k, 0, DX);
+        Set::Scalar normgrad = grad.lpNorm<2>();
 
-                                if (normgrad > 1E-8)
-                                {
-                                    Set::Vector normal = grad / normgrad;
+        if (normgrad > 1E-8)
+        {
+            Set::Vector normal = grad / normgrad;
 
-                                    Set::Scalar da = normgrad * dv;
-                                    area += da;
+            Set::Scalar da = normgrad * dv;
+            area_sum += da;
 
-                                    if (!anisotropy.on || time < anisotropy.tstart)
-                                    {
-                                        gbenergy += pf.sigma0 * da;
+            if (!anisotropy.on || time < anisotropy.tstart)
+            {
+                gbenergy_sum += pf.sigma0 * da;
 
-                                        Set::Scalar k = 0.75 * pf.sigma0 * pf.l_gb;
-                                        realgbenergy += 0.5 * k * normgrad * normgrad * dv;
-                                        regenergy = 0.0;
-                                    }
-                                    else
-                                    {
+                Set::Scalar k = 0.75 * pf.sigma0 * pf.l_gb;
+                realgbenergy_sum += 0.5 * k * normgrad * normgrad * dv;
+            }
+            else
+            {
 #if AMREX_SPACEDIM == 2
-                                        Set::Scalar theta = atan2(grad(1), grad(0));
-                                        Set::Scalar sigma = boundary->W(theta);
-                                        gbenergy += sigma * da;
+                Set::Scalar theta = atan2(grad(1), grad(0));
+                Set::Scalar sigma = boundary->W(theta);
+                gbenergy_sum += sigma * da;
 
-                                        Set::Scalar k = 0.75 * sigma * pf.l_gb;
-                                        realgbenergy += 0.5 * k * normgrad * normgrad * dv;
+                Set::Scalar k = 0.75 * sigma * pf.l_gb;
+                realgbenergy_sum += 0.5 * k * normgrad * normgrad * dv;
 
-                                        Set::Matrix DDeta = Numeric::Hessian(eta, i, j, k, 0, DX);
-                                        Set::Vector tangent(normal[1], -normal[0]);
-                                        Set::Scalar k2 = (DDeta * tangent).dot(tangent);
-                                        regenergy += 0.5 * anisotropy.beta * k2 * k2;
+                Set::Matrix DDeta = Numeric::Hessian(eta, i, j, k, 0, DX);
+                Set::Vector tangent(normal[1], -normal[0]);
+                Set::Scalar k2 = (DDeta * tangent).dot(tangent);
+                regenergy_sum += 0.5 * anisotropy.beta * k2 * k2;
 #elif AMREX_SPACEDIM == 3
-                                        gbenergy += gbmodel.W(normal) * da;
+                gbenergy_sum += (boundary_table_sh ? boundary_table_sh->W(normal) : gbmodel.W(normal)) * da;
 #endif
-                                    }
-                                }
-                            });
+            }
+        }
+    };
+    if (sparse.on)
+    {
+        amrex::Array4<const sparse_type> const &eta = sparse.eta_new[amrlev]->const_array(mfi);
+        amrex::ParallelFor(box, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                                    Set::Scalar patch[sparse_patch_size];
+                                    integrate(SparseGather(eta, i, j, k, 0, 1, patch), i, j, k);
+                                });
+    }
+    else
+    {
+        amrex::Array4<const Set::Scalar> const &eta = (*eta_new_mf[amrlev]).const_array(mfi);
+        amrex::ParallelFor(box, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                                    integrate(eta, i, j, k);
+                                });
+    }
     if (elastic.on)
     {
         amrex::Array4<amrex::Real> const &w        = (*energy_mf[amrlev]).array(mfi);
         amrex::Array4<amrex::Real> const &stress   = (*stress_mf[amrlev]).array(mfi);
         amrex::Array4<amrex::Real> const &u        = (*disp_mf[amrlev])  .array(mfi);
+        auto force_sum = sum(elastic.force), disp_sum = sum(elastic.disp), strainenergy_sum = sum(elastic.strainenergy);
         amrex::ParallelFor(box, [=] AMREX_GPU_DEVICE(int i, int j, int k) 
                                 {
                                     if (j == geom[amrlev].Domain().hiVect()[1])
                                     {
-                                        elastic.force += 0.5*(stress(i,j+1,k,1) + stress(i+1,j+1,k,1)) * DX[0];
-                                        elastic.disp  += 0.5*(u(i,j+1,k,0)      + u(i+1,j+1,k,0)     ) * DX[0];
+                                        force_sum += 0.5*(stress(i,j+1,k,1) + stress(i+1,j+1,k,1)) * DX[0];
+                                        disp_sum  += 0.5*(u(i,j+1,k,0)      + u(i+1,j+1,k,0)     ) * DX[0];
                                     }
-                                    elastic.strainenergy += 0.25 * (w(i,j,k) + w(i+1,j,k) + w(i,j+1,k) + w(i+1,j+1,k)) * volume;
+                                    strainenergy_sum += 0.25 * (w(i,j,k) + w(i+1,j,k) + w(i,j+1,k) + w(i+1,j+1,k)) * dv;
                                 });
     }
 }
@@ -329,9 +329,6 @@ PolymerDegradation::Advance (int lev, amrex::Real time, amrex::Real dt)
             amrex::Array4<amrex::Real> const& time_box = (*damage_start_time[lev]).array(mfi);
 
             amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k){
-                if(std::isnan(water_old_box(i,j,k,0))) Util::Abort(INFO, "Nan found in WATER_OLD(i,j,k)");
-                if(std::isinf(water_old_box(i,j,k,0))) Util::Abort(INFO, "Nan found in WATER_OLD(i,j,k)");
-                
                 if(water_old_box(i,j,k,0) > 1.0)
                 {
                     Util::Warning(INFO,"Water concentration exceeded 1 at (", i, ",", j, ",", "k) and lev = ", lev, " Resetting");
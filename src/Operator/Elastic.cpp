@@ -33,25 +33,76 @@ Elastic<SYM>::define (const Vector<Geometry>& a_geom,
 
     Operator::define(a_geom,a_grids,a_dmap,a_info,a_factory);
 
+    DefineModel(0);
+}
+
+template<int SYM>
+void
+Elastic<SYM>::DefineModel (int a_ntable)
+{
+    BL_PROFILE("Operator::Elastic::DefineModel()");
+
     int model_nghost = 2;
 
+    m_ntable = a_ntable;
+    m_ddw_mf.clear();
+    m_weights_mf.clear();
     m_ddw_mf.resize(m_num_amr_levels);
+    m_weights_mf.resize(m_num_amr_levels);
     for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
     {
         m_ddw_mf[amrlev].resize(m_num_mg_levels[amrlev]);
+        m_weights_mf[amrlev].resize(m_num_mg_levels[amrlev]);
         for (int mglev = 0; mglev < m_num_mg_levels[amrlev]; ++mglev)
         {
-            m_ddw_mf[amrlev][mglev].reset(new MultiTab(amrex::convert(m_grids[amrlev][mglev],
-                                            amrex::IntVect::TheNodeVector()),
-                                m_dmap[amrlev][mglev], 1, model_nghost));
+            amrex::BoxArray ba = amrex::convert(m_grids[amrlev][mglev], amrex::IntVect::TheNodeVector());
+            if (m_ntable == 0)
+                m_ddw_mf[amrlev][mglev].reset(new MultiTab(ba, m_dmap[amrlev][mglev], 1, model_nghost));
+            else
+                m_weights_mf[amrlev][mglev].reset(new MultiFab(ba, m_dmap[amrlev][mglev], m_ntable, model_nghost));
         }
     }
 }
 
+template<int SYM>
+typename Elastic<SYM>::ModelArray
+Elastic<SYM>::GetModelArray (int amrlev, int mglev, const amrex::MFIter &mfi) const
+{
+    ModelArray C;
+    if (m_ntable > 0)
+    {
+        C.w = m_weights_mf[amrlev][mglev]->const_array(mfi);
+        C.table = m_table.data();
+        C.ntable = m_ntable;
+    }
+    else C.ddw = m_ddw_mf[amrlev][mglev]->const_array(mfi);
+    return C;
+}
+
+template<int SYM>
+amrex::Long
+Elastic<SYM>::ModelBytes () const
+{
+    amrex::Long bytes = 0;
+    for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
+        for (int mglev = 0; mglev < m_num_mg_levels[amrlev]; ++mglev)
+        {
+            if (m_ddw_mf[amrlev][mglev])
+                for (MFIter mfi(*m_ddw_mf[amrlev][mglev], false); mfi.isValid(); ++mfi)
+                    bytes += (*m_ddw_mf[amrlev][mglev])[mfi].nBytes();
+            if (m_weights_mf[amrlev][mglev])
+                for (MFIter mfi(*m_weights_mf[amrlev][mglev], false); mfi.isValid(); ++mfi)
+                    bytes += (*m_weights_mf[amrlev][mglev])[mfi].nBytes();
+        }
+    amrex::ParallelDescriptor::ReduceLongSum(bytes);
+    return bytes + (amrex::Long)(m_table.size()*sizeof(MATRIX4));
+}
+
 template <int SYM>
 void 
 Elastic<SYM>::SetModel (MATRIX4 &a_model)
 {
+    if (m_ntable != 0) DefineModel(0);
     for (int amrlev = 0; amrlev < m_num_amr_levels; amrlev++)
     {
         amrex::Box domain(m_geom[amrlev][0].Domain());
@@ -81,6 +132,8 @@ Elastic<SYM>::SetModel (int amrlev, const amrex::FabArray<amrex::BaseFab<MATRIX4
 {
     BL_PROFILE("Operator::Elastic::SetModel()");
 
+    if (m_ntable != 0) DefineModel(0);
+
     amrex::Box domain(m_geom[amrlev][0].Domain());
     domain.convert(amrex::IntVect::TheNodeVector());
 
@@ -111,209 +164,267 @@ Elastic<SYM>::SetModel (int amrlev, const amrex::FabArray<amrex::BaseFab<MATRIX4
     m_model_set = true;
 }
 
+template <int SYM>
+void
+Elastic<SYM>::SetModel (int amrlev, const std::vector<MATRIX4> & a_table, const amrex::MultiFab & a_weights)
+{
+    BL_PROFILE("Operator::Elastic::SetModel()");
+
+    const int ntable = a_table.size();
+
+    if (ntable < 1) Util::Abort(INFO,"Material table is empty");
+    if (a_weights.nComp() != ntable) Util::Abort(INFO,"Inconsistent # of components - weights have ",a_weights.nComp()," but there are ",ntable," materials");
+    if (a_weights.boxArray() != amrex::convert(m_grids[amrlev][0],amrex::IntVect::TheNodeVector())) Util::Abort(INFO,"Inconsistent box arrays");
+    if (a_weights.DistributionMap() != m_dmap[amrlev][0]) Util::Abort(INFO,"Inconsistent distribution maps");
+
+    if (m_ntable != ntable) DefineModel(ntable);
+
+    const int model_nghost = m_weights_mf[amrlev][0]->nGrow();
+    if (a_weights.nGrow() < model_nghost) Util::Abort(INFO,"Weights need at least ",model_nghost," ghost nodes");
+
+    // Copy the table to device memory so that the kernels can mix it
+    m_table.resize(ntable);
+    amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, a_table.begin(), a_table.end(), m_table.begin());
+
+    amrex::Box domain(m_geom[amrlev][0].Domain());
+    domain.convert(amrex::IntVect::TheNodeVector());
+
+    // Only the weights are stored; the coarse MG levels are filled from this
+    // level by averageDownCoeffs, as the moduli are for per-node storage.
+    for (MFIter mfi(a_weights, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        Box bx = mfi.tilebox();
+        bx.grow(model_nghost); // Expand to cover first layer of ghost nodes
+        bx = bx & domain;      // Take intersection of box and the problem domain
+
+        amrex::Array4<Set::Scalar> const& w       = m_weights_mf[amrlev][0]->array(mfi);
+        amrex::Array4<const Set::Scalar> const& W = a_weights.array(mfi);
+
+        amrex::ParallelFor (bx,ntable,[=] AMREX_GPU_DEVICE(int i, int j, int k, int n) {
+                w(i,j,k,n) = W(i,j,k,n);
+            });
+    }
+    amrex::Gpu::streamSynchronize();
+
+    m_model_set = true;
+}
+
 template<int SYM>
 void
 Elastic<SYM>::Fapply (int amrlev, int mglev, MultiFab& a_f, const MultiFab& a_u) const
 {
     BL_PROFILE("Operator::Elastic::Fapply()");
 
+    using BCBase = ::BC::Operator::Elastic::Elastic;
+
     amrex::Box domain(m_geom[amrlev][mglev].Domain());
     domain.convert(amrex::IntVect::TheNodeVector());
+    amrex::Box interior = amrex::grow(domain,-1);
 
     const Real* DX = m_geom[amrlev][mglev].CellSize();
 
+    const bool uniform = m_uniform;
+
+    // Resolve the boundary condition on every face, edge and corner once, so
+    // that the boundary kernels below need no virtual calls. BCs that cannot
+    // be described this way are evaluated through operator() instead.
+    std::array<BCBase::Descriptor,BCBase::nfaces> bcdesc;
+    bool devirtualized = true;
+    for (int face = 0; face < BCBase::nfaces; face++)
+        devirtualized = m_bc->GetDescriptor((BCBase::Face)face, bcdesc[face]) && devirtualized;
+
     for (MFIter mfi(a_f, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
     {
         Box bx = mfi.tilebox();
         bx.grow(1);        // Expand to cover first layer of ghost nodes
         bx = bx & domain;  // Take intersection of box and the problem domain
             
-        amrex::Array4<MATRIX4> const& DDW                 = (*(m_ddw_mf[amrlev][mglev])).array(mfi);
+        const ModelArray DDW                      = GetModelArray(amrlev,mglev,mfi);
         amrex::Array4<const amrex::Real> const& U = a_u.array(mfi);
         amrex::Array4<amrex::Real> const& F       = a_f.array(mfi);
 
-        const Dim3 lo= amrex::lbound(domain), hi = amrex::ubound(domain);
-            
-        amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k) {
-                    
-                Set::Vector f = Set::Vector::Zero();
-
-                Set::Vector u;
-                for (int p = 0; p < AMREX_SPACEDIM; p++) u(p) = U(i,j,k,p);
-                
-
-                bool AMREX_D_DECL(xmin = (i == lo.x), ymin = (j==lo.y), zmin = (k==lo.z)),
-                    AMREX_D_DECL(xmax = (i == hi.x), ymax = (j==hi.y), zmax = (k==hi.z));
-
-                // Determine if a special stencil will be necessary for first derivatives
-                std::array<Numeric::StencilType,AMREX_SPACEDIM>
-                    sten = Numeric::GetStencil(i,j,k,domain);
+        //
+        // Interior nodes: central differences everywhere, no boundary checks.
+        //
+        // The return value is
+        //    f = C(grad grad u) + grad(C)*grad(u)
+        // In index notation
+        //    f_i = C_{ijkl,j} u_{k,l}  +  C_{ijkl}u_{k,lj}
+        //
+        amrex::ParallelFor (bx & interior,[=] AMREX_GPU_DEVICE(int i, int j, int k) {
 
                 // The displacement gradient tensor
                 Set::Matrix gradu; // gradu(i,j) = u_{i,j)
 
-                // Fill gradu
+                // The gradient of the displacement gradient tensor
+                Set::Matrix3 gradgradu; // gradgradu[k](l,j) = u_{k,lj}
+
+                // Fill gradu and gradgradu
                 for (int p = 0; p < AMREX_SPACEDIM; p++)
                 {
-                    AMREX_D_TERM(gradu(p,0) = (Numeric::Stencil<Set::Scalar,1,0,0>::D(U,i,j,k,p,DX,sten));,
-                            gradu(p,1) = (Numeric::Stencil<Set::Scalar,0,1,0>::D(U,i,j,k,p,DX,sten));,
-                            gradu(p,2) = (Numeric::Stencil<Set::Scalar,0,0,1>::D(U,i,j,k,p,DX,sten)););
+                    AMREX_D_TERM(gradu(p,0) = (Numeric::Stencil<Set::Scalar,1,0,0>::D(U,i,j,k,p,DX));,
+                            gradu(p,1) = (Numeric::Stencil<Set::Scalar,0,1,0>::D(U,i,j,k,p,DX));,
+                            gradu(p,2) = (Numeric::Stencil<Set::Scalar,0,0,1>::D(U,i,j,k,p,DX)););
+
+                    // Diagonal terms:
+                    AMREX_D_TERM(gradgradu(p,0,0) = (Numeric::Stencil<Set::Scalar,2,0,0>::D(U,i,j,k,p,DX));,
+                            gradgradu(p,1,1) = (Numeric::Stencil<Set::Scalar,0,2,0>::D(U,i,j,k,p,DX));,
+                            gradgradu(p,2,2) = (Numeric::Stencil<Set::Scalar,0,0,2>::D(U,i,j,k,p,DX)););
+
+                    // Off-diagonal terms:
+                    AMREX_D_TERM(,// 2D
+                            gradgradu(p,0,1) = (Numeric::Stencil<Set::Scalar,1,1,0>::D(U, i,j,k,p, DX));
+                            gradgradu(p,1,0) = gradgradu(p,0,1);
+                            ,// 3D
+                            gradgradu(p,0,2) = (Numeric::Stencil<Set::Scalar,1,0,1>::D(U, i,j,k,p, DX));
+                            gradgradu(p,1,2) = (Numeric::Stencil<Set::Scalar,0,1,1>::D(U, i,j,k,p, DX));
+                            gradgradu(p,2,0) = gradgradu(p,0,2);
+                            gradgradu(p,2,1) = gradgradu(p,1,2););
                 }
-                    
-                // Stress tensor computed using the model fab
-                Set::Matrix sig = DDW(i,j,k)*gradu;
 
-                // Boundary conditions
-                /// \todo Important: we need a way to handle corners and edges.
-                amrex::IntVect m(AMREX_D_DECL(i,j,k));
-                if (AMREX_D_TERM(xmax || xmin, || ymax || ymin, || zmax || zmin)) 
+                Set::Vector f = DDW(i,j,k)*gradgradu;
+
+                if (!uniform)
                 {
-                    f = (*m_bc)(u,gradu,sig,i,j,k,domain);
+                    MATRIX4
+                    AMREX_D_DECL(Cgrad1 = (DDW.template D<1,0,0>(i,j,k,DX)),
+                                Cgrad2 = (DDW.template D<0,1,0>(i,j,k,DX)),
+                                Cgrad3 = (DDW.template D<0,0,1>(i,j,k,DX)));
+                    f += AMREX_D_TERM((Cgrad1*gradu).col(0),
+                                    +(Cgrad2*gradu).col(1),
+                                    +(Cgrad3*gradu).col(2));
                 }
-                else
-                {
-                    
+                AMREX_D_TERM(F(i,j,k,0) = f[0];, F(i,j,k,1) = f[1];, F(i,j,k,2) = f[2];);
+            });
+
+        //
+        // Boundary nodes: one kernel per face, edge and corner that
+        // intersects this tile, with the BC for that region fixed.
+        //
+        for (int face = 0; face < BCBase::nfaces; face++)
+        {
+            Box fbx = bx & BCBase::Region(domain,(BCBase::Face)face);
+            if (!fbx.ok()) continue;
+            const BCBase::Descriptor desc = bcdesc[face];
+
+            amrex::ParallelFor (fbx,[=] AMREX_GPU_DEVICE(int i, int j, int k) {
+
+                    Set::Vector u;
+                    for (int p = 0; p < AMREX_SPACEDIM; p++) u(p) = U(i,j,k,p);
 
-                    // The gradient of the displacement gradient tensor
-                    Set::Matrix3 gradgradu; // gradgradu[k](l,j) = u_{k,lj}
+                    // One-sided stencils normal to the boundary. These stay
+                    // first order to match DiagonalPoint.
+                    std::array<Numeric::StencilType,AMREX_SPACEDIM>
+                        sten = Numeric::GetStencil(i,j,k,domain);
 
-                    // Fill gradu and gradgradu
+                    Set::Matrix gradu; // gradu(i,j) = u_{i,j)
                     for (int p = 0; p < AMREX_SPACEDIM; p++)
                     {
-                        // Diagonal terms:
-                        AMREX_D_TERM(gradgradu(p,0,0) = (Numeric::Stencil<Set::Scalar,2,0,0>::D(U,i,j,k,p,DX));,
-                                gradgradu(p,1,1) = (Numeric::Stencil<Set::Scalar,0,2,0>::D(U,i,j,k,p,DX));,
-                                gradgradu(p,2,2) = (Numeric::Stencil<Set::Scalar,0,0,2>::D(U,i,j,k,p,DX)););
-
-                        // Off-diagonal terms:
-                        AMREX_D_TERM(,// 2D
-                                gradgradu(p,0,1) = (Numeric::Stencil<Set::Scalar,1,1,0>::D(U, i,j,k,p, DX));
-                                gradgradu(p,1,0) = gradgradu(p,0,1);
-                                ,// 3D
-                                gradgradu(p,0,2) = (Numeric::Stencil<Set::Scalar,1,0,1>::D(U, i,j,k,p, DX));
-                                gradgradu(p,1,2) = (Numeric::Stencil<Set::Scalar,0,1,1>::D(U, i,j,k,p, DX));
-                                gradgradu(p,2,0) = gradgradu(p,0,2);
-                                gradgradu(p,2,1) = gradgradu(p,1,2););
+                        AMREX_D_TERM(gradu(p,0) = (Numeric::Stencil<Set::Scalar,1,0,0>::D(U,i,j,k,p,DX,sten));,
+                                gradu(p,1) = (Numeric::Stencil<Set::Scalar,0,1,0>::D(U,i,j,k,p,DX,sten));,
+                                gradu(p,2) = (Numeric::Stencil<Set::Scalar,0,0,1>::D(U,i,j,k,p,DX,sten)););
                     }
-    
-                    //
-                    // Operator
-                    //
-                    // The return value is
-                    //    f = C(grad grad u) + grad(C)*grad(u)
-                    // In index notation
-                    //    f_i = C_{ijkl,j} u_{k,l}  +  C_{ijkl}u_{k,lj}
-                    //
-
-                    f = DDW(i,j,k)*gradgradu;
-
-                    if (!m_uniform)
-                    {
-                        MATRIX4
-                        AMREX_D_DECL(Cgrad1 = (Numeric::Stencil<MATRIX4,1,0,0>::D(DDW,i,j,k,0,DX,sten)),
-                                    Cgrad2 = (Numeric::Stencil<MATRIX4,0,1,0>::D(DDW,i,j,k,0,DX,sten)),
-                                    Cgrad3 = (Numeric::Stencil<MATRIX4,0,0,1>::D(DDW,i,j,k,0,DX,sten)));
-                        f += AMREX_D_TERM((Cgrad1*gradu).col(0),
-                                        +(Cgrad2*gradu).col(1),
-                                        +(Cgrad3*gradu).col(2));
-                    }
-                }
-                AMREX_D_TERM(F(i,j,k,0) = f[0];, F(i,j,k,1) = f[1];, F(i,j,k,2) = f[2];);
-            });
+
+                    // Stress tensor computed using the model fab
+                    Set::Matrix sig = DDW(i,j,k)*gradu;
+
+                    Set::Vector f = devirtualized ? BCBase::Evaluate(desc,u,gradu,sig)
+                                                  : (*m_bc)(u,gradu,sig,i,j,k,domain);
+
+                    AMREX_D_TERM(F(i,j,k,0) = f[0];, F(i,j,k,1) = f[1];, F(i,j,k,2) = f[2];);
+                });
+        }
     }
 }
 
 
 
 template<int SYM>
-void
-Elastic<SYM>::Diagonal (int amrlev, int mglev, MultiFab& a_diag)
+Set::Vector
+Elastic<SYM>::DiagonalPoint (int amrlev, int mglev, int i, int j, int k,
+                             const amrex::Box &domain, const Set::Scalar *DX,
+                             const ModelArray &DDW) const
 {
-    BL_PROFILE("Operator::Elastic::Diagonal()");
+    Set::Vector diag = Set::Vector::Zero();
 
-    amrex::Box domain(m_geom[amrlev][mglev].Domain());
-    domain.convert(amrex::IntVect::TheNodeVector());
-    const Real* DX = m_geom[amrlev][mglev].CellSize();
-    
-    for (MFIter mfi(a_diag, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
-    {
-        Box bx = mfi.validbox();
-        bx.grow(1);        // Expand to cover first layer of ghost nodes
-        bx = bx & domain;  // Take intersection of box and the problem domain
-
-        amrex::Array4<MATRIX4> const& DDW         = (*(m_ddw_mf[amrlev][mglev])).array(mfi);
-        amrex::Array4<amrex::Real> const& diag    = a_diag.array(mfi);
-
-        const Dim3 lo= amrex::lbound(domain), hi = amrex::ubound(domain);
-            
-        amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k) {
-
-                Set::Vector f = Set::Vector::Zero();
+    const Dim3 lo= amrex::lbound(domain), hi = amrex::ubound(domain);
+    bool    AMREX_D_DECL(xmin = (i == lo.x), ymin = (j==lo.y), zmin = (k==lo.z)),
+            AMREX_D_DECL(xmax = (i == hi.x), ymax = (j==hi.y), zmax = (k==hi.z));
 
-                bool    AMREX_D_DECL(xmin = (i == lo.x), ymin = (j==lo.y), zmin = (k==lo.z)),
-                        AMREX_D_DECL(xmax = (i == hi.x), ymax = (j==hi.y), zmax = (k==hi.z));
+    std::array<Numeric::StencilType,AMREX_SPACEDIM> sten
+        = Numeric::GetStencil(i,j,k,domain);
 
-                std::array<Numeric::StencilType,AMREX_SPACEDIM> sten
-                    = Numeric::GetStencil(i,j,k,domain);
+    MATRIX4 C = DDW(i,j,k);
 
+    Set::Matrix gradu; // gradu(i,j) = u_{i,j)
+    Set::Matrix3 gradgradu; // gradgradu[k](l,j) = u_{k,lj}
 
-                
+    for (int p = 0; p < AMREX_SPACEDIM; p++)
+    {
+        for (int q = 0; q < AMREX_SPACEDIM; q++)
+        {
+            AMREX_D_TERM(gradu(q,0) = ((!xmax ? 0.0 : (p==q ? 1.0 : 0.0)) - (!xmin ? 0.0 : (p==q ? 1.0 : 0.0)))/((xmin || xmax ? 1.0 : 2.0)*DX[0]);,
+                    gradu(q,1) = ((!ymax ? 0.0 : (p==q ? 1.0 : 0.0)) - (!ymin ? 0.0 : (p==q ? 1.0 : 0.0)))/((ymin || ymax ? 1.0 : 2.0)*DX[1]);,
+                    gradu(q,2) = ((!zmax ? 0.0 : (p==q ? 1.0 : 0.0)) - (!zmin ? 0.0 : (p==q ? 1.0 : 0.0)))/((zmin || zmax ? 1.0 : 2.0)*DX[2]););
+
+            AMREX_D_TERM(gradgradu(q,0,0) = (p==q ? -2.0 : 0.0)/DX[0]/DX[0];
+                    ,// 2D
+                    gradgradu(q,0,1) = 0.0;
+                    gradgradu(q,1,0) = 0.0;
+                    gradgradu(q,1,1) = (p==q ? -2.0 : 0.0)/DX[1]/DX[1];
+                    ,// 3D
+                    gradgradu(q,0,2) = 0.0;
+                    gradgradu(q,1,2) = 0.0;
+                    gradgradu(q,2,0) = 0.0;
+                    gradgradu(q,2,1) = 0.0;
+                    gradgradu(q,2,2) = (p==q ? -2.0 : 0.0)/DX[2]/DX[2]);
+        }
 
-                Set::Matrix gradu; // gradu(i,j) = u_{i,j)
-                Set::Matrix3 gradgradu; // gradgradu[k](l,j) = u_{k,lj}
+        Set::Matrix sig = C*gradu;
 
-                for (int p = 0; p < AMREX_SPACEDIM; p++)
-                {
+        if (AMREX_D_TERM(xmax || xmin, || ymax || ymin, || zmax || zmin)) 
+        {
+            Set::Vector u = Set::Vector::Zero();
+            u(p) = 1.0;
+            Set::Vector f = (*m_bc)(u,gradu,sig,i,j,k,domain);
+            diag(p) = f(p);
+        }
+        else
+        {
+            Set::Matrix4<AMREX_SPACEDIM,SYM>
+            AMREX_D_DECL(Cgrad1 = (DDW.template D<1,0,0>(i,j,k,DX,sten)),
+                            Cgrad2 = (DDW.template D<0,1,0>(i,j,k,DX,sten)),
+                        Cgrad3 = (DDW.template D<0,0,1>(i,j,k,DX,sten)));
 
-                    diag(i,j,k,p) = 0.0;
-                    for (int q = 0; q < AMREX_SPACEDIM; q++)
-                    {
-                        AMREX_D_TERM(gradu(q,0) = ((!xmax ? 0.0 : (p==q ? 1.0 : 0.0)) - (!xmin ? 0.0 : (p==q ? 1.0 : 0.0)))/((xmin || xmax ? 1.0 : 2.0)*DX[0]);,
-                                gradu(q,1) = ((!ymax ? 0.0 : (p==q ? 1.0 : 0.0)) - (!ymin ? 0.0 : (p==q ? 1.0 : 0.0)))/((ymin || ymax ? 1.0 : 2.0)*DX[1]);,
-                                gradu(q,2) = ((!zmax ? 0.0 : (p==q ? 1.0 : 0.0)) - (!zmin ? 0.0 : (p==q ? 1.0 : 0.0)))/((zmin || zmax ? 1.0 : 2.0)*DX[2]););
-            
-                        AMREX_D_TERM(gradgradu(q,0,0) = (p==q ? -2.0 : 0.0)/DX[0]/DX[0];
-                                ,// 2D
-                                gradgradu(q,0,1) = 0.0;
-                                gradgradu(q,1,0) = 0.0;
-                                gradgradu(q,1,1) = (p==q ? -2.0 : 0.0)/DX[1]/DX[1];
-                                ,// 3D
-                                gradgradu(q,0,2) = 0.0;
-                                gradgradu(q,1,2) = 0.0;
-                                gradgradu(q,2,0) = 0.0;
-                                gradgradu(q,2,1) = 0.0;
-                                gradgradu(q,2,2) = (p==q ? -2.0 : 0.0)/DX[2]/DX[2]);
-                    }
+            Set::Vector f = C*gradgradu + 
+                AMREX_D_TERM((Cgrad1*gradu).col(0),
+                            +(Cgrad2*gradu).col(1),
+                            +(Cgrad3*gradu).col(2));
 
-                    Set::Matrix sig = DDW(i,j,k)*gradu;
+            diag(p) = f(p);
+        }
+        if (std::isnan(diag(p))) Util::Abort(INFO,"diagonal is nan at (", i, ",", j , ",",k,"), amrlev=",amrlev,", mglev=",mglev);
+    }
+    return diag;
+}
 
-                    amrex::IntVect m(AMREX_D_DECL(i,j,k));
-                    if (AMREX_D_TERM(xmax || xmin, || ymax || ymin, || zmax || zmin)) 
-                    {
-                        Set::Vector u = Set::Vector::Zero();
-                        u(p) = 1.0;
-                        f = (*m_bc)(u,gradu,sig,i,j,k,domain);
-                        diag(i,j,k,p) = f(p);
-                    }
-                    else
-                    {
-                        Set::Matrix4<AMREX_SPACEDIM,SYM>
-                        AMREX_D_DECL(Cgrad1 = (Numeric::Stencil<Set::Matrix4<AMREX_SPACEDIM,SYM>,1,0,0>::D(DDW,i,j,k,0,DX,sten)),
-                                        Cgrad2 = (Numeric::Stencil<Set::Matrix4<AMREX_SPACEDIM,SYM>,0,1,0>::D(DDW,i,j,k,0,DX,sten)),
-                                    Cgrad3 = (Numeric::Stencil<Set::Matrix4<AMREX_SPACEDIM,SYM>,0,0,1>::D(DDW,i,j,k,0,DX,sten)));
+template<int SYM>
+void
+Elastic<SYM>::Diag (int amrlev, int mglev, const amrex::MFIter &mfi,
+                    const amrex::Box &bx, const amrex::Array4<Set::Scalar> &diag) const
+{
+    BL_PROFILE("Operator::Elastic::Diag()");
 
-                        Set::Vector f = DDW(i,j,k)*gradgradu + 
-                            AMREX_D_TERM((Cgrad1*gradu).col(0),
-                                        +(Cgrad2*gradu).col(1),
-                                        +(Cgrad3*gradu).col(2));
+    amrex::Box domain(m_geom[amrlev][mglev].Domain());
+    domain.convert(amrex::IntVect::TheNodeVector());
+    const Real* DX = m_geom[amrlev][mglev].CellSize();
 
-                        diag(i,j,k,p) += f(p);
-                    }
-                    if (std::isnan(diag(i,j,k,p))) Util::Abort(INFO,"diagonal is nan at (", i, ",", j , ",",k,"), amrlev=",amrlev,", mglev=",mglev);
+    const ModelArray DDW = GetModelArray(amrlev,mglev,mfi);
 
-                }
-            });
-    }
+    amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k) {
+            Set::Vector d = DiagonalPoint(amrlev,mglev,i,j,k,domain,DX,DDW);
+            for (int p = 0; p < AMREX_SPACEDIM; p++) diag(i,j,k,p) = d(p);
+        });
 }
 
 
@@ -439,7 +550,7 @@ Elastic<SYM>::Stress (int amrlev,
     for (MFIter mfi(a_u, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
     {
         const Box& bx = mfi.tilebox();
-        amrex::Array4<Set::Matrix4<AMREX_SPACEDIM,SYM>> const& DDW                 = (*(m_ddw_mf[amrlev][0])).array(mfi);
+        const ModelArray DDW = GetModelArray(amrlev,0,mfi);
         amrex::Array4<amrex::Real> const& sigma   = a_sigma.array(mfi);
         amrex::Array4<const amrex::Real> const& u = a_u.array(mfi);
         amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k)
@@ -456,7 +567,7 @@ Elastic<SYM>::Stress (int amrlev,
                                     gradu(p,1) = (Numeric::Stencil<Set::Scalar,0,1,0>::D(u, i,j,k,p, DX, sten));,
                                         gradu(p,2) = (Numeric::Stencil<Set::Scalar,0,0,1>::D(u, i,j,k,p, DX, sten)););
                         }
-                     
+
                         Set::Matrix sig = DDW(i,j,k)*gradu;
 
                         if (voigt)
@@ -501,7 +612,7 @@ Elastic<SYM>::Energy (int amrlev,
     for (MFIter mfi(a_u, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
     {
         const Box& bx = mfi.tilebox();
-        amrex::Array4<Set::Matrix4<AMREX_SPACEDIM,SYM>> const& DDW                  = (*(m_ddw_mf[amrlev][0])).array(mfi);
+        const ModelArray DDW = GetModelArray(amrlev,0,mfi);
         amrex::Array4<amrex::Real> const& energy   = a_energy.array(mfi);
         amrex::Array4<const amrex::Real> const& u  = a_u.array(mfi);
         amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k)
@@ -590,35 +701,49 @@ void
 Elastic<SYM>::averageDownCoeffs ()
 {
     BL_PROFILE("Elastic::averageDownCoeffs()");
-    
+
+    // The moduli are linear in the weights, so averaging the weights of a
+    // material table gives the same coarse moduli as averaging the moduli.
+    if (m_ntable > 0) averageDownCoeffsAllLevels(m_weights_mf);
+    else averageDownCoeffsAllLevels(m_ddw_mf);
+}
+
+template<int SYM>
+template<class FIELD>
+void
+Elastic<SYM>::averageDownCoeffsAllLevels (amrex::Vector<FIELD> &a_mf)
+{
     if (m_average_down_coeffs)
         for (int amrlev = m_num_amr_levels-1; amrlev > 0; --amrlev)
-            averageDownCoeffsDifferentAmrLevels(amrlev);
+            averageDownCoeffsDifferentAmrLevels(amrlev,a_mf);
 
-    averageDownCoeffsSameAmrLevel(0);
+    averageDownCoeffsSameAmrLevel(0,a_mf[0]);
     for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
     {
         for (int mglev = 0; mglev < m_num_mg_levels[amrlev]; ++mglev)
         {
-            if (m_ddw_mf[amrlev][mglev]) {
-                FillBoundaryCoeff(*m_ddw_mf[amrlev][mglev], m_geom[amrlev][mglev]);
+            if (a_mf[amrlev][mglev]) {
+                FillBoundaryCoeff(*a_mf[amrlev][mglev], m_geom[amrlev][mglev]);
             }
         }
     }
 }
 
 template<int SYM>
+template<class FIELD>
 void
-Elastic<SYM>::averageDownCoeffsDifferentAmrLevels (int fine_amrlev)
+Elastic<SYM>::averageDownCoeffsDifferentAmrLevels (int fine_amrlev, amrex::Vector<FIELD> &a_mf)
 {
     BL_PROFILE("Operator::Elastic::averageDownCoeffsDifferentAmrLevels()");
     Util::Assert(INFO,TEST(fine_amrlev > 0));
     
     const int crse_amrlev = fine_amrlev - 1;
-    const int ncomp = 1;
 
-    MultiTab & crse_ddw = *m_ddw_mf[crse_amrlev][0];
-    MultiTab & fine_ddw = *m_ddw_mf[fine_amrlev][0];
+    auto & crse_ddw = *a_mf[crse_amrlev][0];
+    auto & fine_ddw = *a_mf[fine_amrlev][0];
+    using MF = typename std::remove_reference<decltype(fine_ddw)>::type;
+    using T  = typename MF::value_type;
+    const int ncomp = fine_ddw.nComp();
 
     amrex::Box cdomain(m_geom[crse_amrlev][0].Domain());
     cdomain.convert(amrex::IntVect::TheNodeVector());
@@ -628,7 +753,7 @@ Elastic<SYM>::averageDownCoeffsDifferentAmrLevels (int fine_amrlev)
     const BoxArray&            fba = fine_ddw.boxArray();
     const DistributionMapping& fdm = fine_ddw.DistributionMap();
 
-    MultiTab fine_ddw_for_coarse(amrex::coarsen(fba, 2), fdm, ncomp, 2);
+    MF fine_ddw_for_coarse(amrex::coarsen(fba, 2), fdm, ncomp, 2);
     fine_ddw_for_coarse.ParallelCopy(crse_ddw,0,0,ncomp,0,0,cgeom.periodicity());
 
     const int coarse_fine_node = 1;
@@ -647,12 +772,12 @@ Elastic<SYM>::averageDownCoeffsDifferentAmrLevels (int fine_amrlev)
         amrex::Array4<const int> const& nmask = nodemask.array(mfi);
         //amrex::Array4<const int> const& cmask = cellmask.array(mfi);
 
-        amrex::Array4<MATRIX4> const& cdata = fine_ddw_for_coarse.array(mfi);
-        amrex::Array4<const MATRIX4> const& fdata       = fine_ddw.array(mfi);
+        amrex::Array4<T> const& cdata = fine_ddw_for_coarse.array(mfi);
+        amrex::Array4<const T> const& fdata       = fine_ddw.array(mfi);
 
         const Dim3 lo= amrex::lbound(cdomain), hi = amrex::ubound(cdomain);
 
-        for (int n = 0; n < fine_ddw.nComp(); n++)
+        for (int n = 0; n < ncomp; n++)
         {
             // I,J,K == coarse coordinates
             // i,j,k == fine coordinates
@@ -719,8 +844,9 @@ Elastic<SYM>::averageDownCoeffsDifferentAmrLevels (int fine_amrlev)
 
 
 template<int SYM>
+template<class FIELD>
 void
-Elastic<SYM>::averageDownCoeffsSameAmrLevel (int amrlev)
+Elastic<SYM>::averageDownCoeffsSameAmrLevel (int amrlev, FIELD &a_mf)
 {
     BL_PROFILE("Elastic::averageDownCoeffsSameAmrLevel()");
 
@@ -731,74 +857,77 @@ Elastic<SYM>::averageDownCoeffsSameAmrLevel (int amrlev)
         amrex::Box fdomain(m_geom[amrlev][mglev-1].Domain());
         fdomain.convert(amrex::IntVect::TheNodeVector());
 
-        MultiTab& crse = *m_ddw_mf[amrlev][mglev];
-        MultiTab& fine = *m_ddw_mf[amrlev][mglev-1];
+        auto& crse = *a_mf[mglev];
+        auto& fine = *a_mf[mglev-1];
+        using MF = typename std::remove_reference<decltype(fine)>::type;
+        using T  = typename MF::value_type;
+        const int ncomp = fine.nComp();
         
         amrex::BoxArray crseba = crse.boxArray();
         amrex::BoxArray fineba = fine.boxArray();
         
         BoxArray newba = crseba;
         newba.refine(2);
-        MultiTab fine_on_crseba;
-        fine_on_crseba.define(newba,crse.DistributionMap(),1,4);
-        fine_on_crseba.ParallelCopy(fine,0,0,1,2,4,m_geom[amrlev][mglev].periodicity());
+        MF fine_on_crseba;
+        fine_on_crseba.define(newba,crse.DistributionMap(),ncomp,4);
+        fine_on_crseba.ParallelCopy(fine,0,0,ncomp,2,4,m_geom[amrlev][mglev].periodicity());
 
         for (MFIter mfi(crse, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
         {
             Box bx = mfi.tilebox();
             bx = bx & cdomain;
 
-            amrex::Array4<const Set::Matrix4<AMREX_SPACEDIM,SYM>> const& fdata = fine_on_crseba.array(mfi);
-            amrex::Array4<Set::Matrix4<AMREX_SPACEDIM,SYM>> const& cdata       = crse.array(mfi);
+            amrex::Array4<const T> const& fdata = fine_on_crseba.array(mfi);
+            amrex::Array4<T> const& cdata       = crse.array(mfi);
 
             const Dim3 lo= amrex::lbound(cdomain), hi = amrex::ubound(cdomain);
 
             // I,J,K == coarse coordinates
             // i,j,k == fine coordinates
-            amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int I, int J, int K) {
+            amrex::ParallelFor (bx,ncomp,[=] AMREX_GPU_DEVICE(int I, int J, int K, int n) {
                     int i=2*I, j=2*J, k=2*K;
 
                     if ((I == lo.x || I == hi.x) &&
                         (J == lo.y || J == hi.y) &&
                         (K == lo.z || K == hi.z)) // Corner
-                        cdata(I,J,K) = fdata(i,j,k);
+                        cdata(I,J,K,n) = fdata(i,j,k,n);
                     else if ((J == lo.y || J == hi.y) &&
                         (K == lo.z || K == hi.z)) // X edge
-                        cdata(I,J,K) = fdata(i-1,j,k)*0.25 + fdata(i,j,k)*0.5 + fdata(i+1,j,k)*0.25;
+                        cdata(I,J,K,n) = fdata(i-1,j,k,n)*0.25 + fdata(i,j,k,n)*0.5 + fdata(i+1,j,k,n)*0.25;
                     else if ((K == lo.z || K == hi.z) &&
                         (I == lo.x || I == hi.x)) // Y edge
-                        cdata(I,J,K) = fdata(i,j-1,k)*0.25 + fdata(i,j,k)*0.5 + fdata(i,j+1,k)*0.25;
+                        cdata(I,J,K,n) = fdata(i,j-1,k,n)*0.25 + fdata(i,j,k,n)*0.5 + fdata(i,j+1,k,n)*0.25;
                     else if ((I == lo.x || I == hi.x) &&
                         (J == lo.y || J == hi.y)) // Z edge
-                        cdata(I,J,K) = fdata(i,j,k-1)*0.25 + fdata(i,j,k)*0.5 + fdata(i,j,k+1)*0.25;
+                        cdata(I,J,K,n) = fdata(i,j,k-1,n)*0.25 + fdata(i,j,k,n)*0.5 + fdata(i,j,k+1,n)*0.25;
                     else if (I == lo.x || I == hi.x) // X face
-                        cdata(I,J,K) =
-                            (  fdata(i,j-1,k-1)     + fdata(i,j,k-1)*2.0 + fdata(i,j+1,k-1)
-                            + fdata(i,j-1,k  )*2.0 + fdata(i,j,k  )*4.0 + fdata(i,j+1,k  )*2.0 
-                            + fdata(i,j-1,k+1)     + fdata(i,j,k+1)*2.0 + fdata(i,j+1,k+1)    )/16.0;
+                        cdata(I,J,K,n) =
+                            (  fdata(i,j-1,k-1,n)     + fdata(i,j,k-1,n)*2.0 + fdata(i,j+1,k-1,n)
+                            + fdata(i,j-1,k  ,n)*2.0 + fdata(i,j,k  ,n)*4.0 + fdata(i,j+1,k  ,n)*2.0 
+                            + fdata(i,j-1,k+1,n)     + fdata(i,j,k+1,n)*2.0 + fdata(i,j+1,k+1,n)    )/16.0;
                     else if (J == lo.y || J == hi.y) // Y face
-                        cdata(I,J,K) =
-                            (  fdata(i-1,j,k-1)     + fdata(i-1,j,k)*2.0 + fdata(i-1,j,k+1)
-                            + fdata(i  ,j,k-1)*2.0 + fdata(i  ,j,k)*4.0 + fdata(i  ,j,k+1)*2.0 
-                            + fdata(i+1,j,k-1)     + fdata(i+1,j,k)*2.0 + fdata(i+1,j,k+1))/16.0;
+                        cdata(I,J,K,n) =
+                            (  fdata(i-1,j,k-1,n)     + fdata(i-1,j,k,n)*2.0 + fdata(i-1,j,k+1,n)
+                            + fdata(i  ,j,k-1,n)*2.0 + fdata(i  ,j,k,n)*4.0 + fdata(i  ,j,k+1,n)*2.0 
+                            + fdata(i+1,j,k-1,n)     + fdata(i+1,j,k,n)*2.0 + fdata(i+1,j,k+1,n))/16.0;
                     else if (K == lo.z || K == hi.z) // Z face
-                        cdata(I,J,K) =
-                            (  fdata(i-1,j-1,k)     + fdata(i,j-1,k)*2.0 + fdata(i+1,j-1,k)
-                            + fdata(i-1,j  ,k)*2.0 + fdata(i,j  ,k)*4.0 + fdata(i+1,j  ,k)*2.0 
-                            + fdata(i-1,j+1,k)     + fdata(i,j+1,k)*2.0 + fdata(i+1,j+1,k))/16.0;
+                        cdata(I,J,K,n) =
+                            (  fdata(i-1,j-1,k,n)     + fdata(i,j-1,k,n)*2.0 + fdata(i+1,j-1,k,n)
+                            + fdata(i-1,j  ,k,n)*2.0 + fdata(i,j  ,k,n)*4.0 + fdata(i+1,j  ,k,n)*2.0 
+                            + fdata(i-1,j+1,k,n)     + fdata(i,j+1,k,n)*2.0 + fdata(i+1,j+1,k,n))/16.0;
                     else // Interior
-                        cdata(I,J,K) =
-                            (fdata(i-1,j-1,k-1) + fdata(i-1,j-1,k+1) + fdata(i-1,j+1,k-1) + fdata(i-1,j+1,k+1) +
-                            fdata(i+1,j-1,k-1) + fdata(i+1,j-1,k+1) + fdata(i+1,j+1,k-1) + fdata(i+1,j+1,k+1)) / 64.0
+                        cdata(I,J,K,n) =
+                            (fdata(i-1,j-1,k-1,n) + fdata(i-1,j-1,k+1,n) + fdata(i-1,j+1,k-1,n) + fdata(i-1,j+1,k+1,n) +
+                            fdata(i+1,j-1,k-1,n) + fdata(i+1,j-1,k+1,n) + fdata(i+1,j+1,k-1,n) + fdata(i+1,j+1,k+1,n)) / 64.0
                             +
-                            (fdata(i,j-1,k-1) + fdata(i,j-1,k+1) + fdata(i,j+1,k-1) + fdata(i,j+1,k+1) +
-                            fdata(i-1,j,k-1) + fdata(i+1,j,k-1) + fdata(i-1,j,k+1) + fdata(i+1,j,k+1) +
-                            fdata(i-1,j-1,k) + fdata(i-1,j+1,k) + fdata(i+1,j-1,k) + fdata(i+1,j+1,k)) / 32.0
+                            (fdata(i,j-1,k-1,n) + fdata(i,j-1,k+1,n) + fdata(i,j+1,k-1,n) + fdata(i,j+1,k+1,n) +
+                            fdata(i-1,j,k-1,n) + fdata(i+1,j,k-1,n) + fdata(i-1,j,k+1,n) + fdata(i+1,j,k+1,n) +
+                            fdata(i-1,j-1,k,n) + fdata(i-1,j+1,k,n) + fdata(i+1,j-1,k,n) + fdata(i+1,j+1,k,n)) / 32.0
                             +
-                            (fdata(i-1,j,k) + fdata(i,j-1,k) + fdata(i,j,k-1) +
-                            fdata(i+1,j,k) + fdata(i,j+1,k) + fdata(i,j,k+1)) / 16.0
+                            (fdata(i-1,j,k,n) + fdata(i,j-1,k,n) + fdata(i,j,k-1,n) +
+                            fdata(i+1,j,k,n) + fdata(i,j+1,k,n) + fdata(i,j,k+1,n)) / 16.0
                             +
-                            fdata(i,j,k) / 8.0;
+                            fdata(i,j,k,n) / 8.0;
                 });
         }
         FillBoundaryCoeff(crse,m_geom[amrlev][mglev]);
@@ -806,18 +935,19 @@ Elastic<SYM>::averageDownCoeffsSameAmrLevel (int amrlev)
 }
 
 template<int SYM>
+template<class MF>
 void
-Elastic<SYM>::FillBoundaryCoeff (MultiTab& sigma, const Geometry& geom)
+Elastic<SYM>::FillBoundaryCoeff (MF& sigma, const Geometry& geom)
 {
     BL_PROFILE("Elastic::FillBoundaryCoeff()");
     for (int i = 0; i < 2; i++)
     {
-        MultiTab & mf = sigma;
+        MF & mf = sigma;
         mf.FillBoundary(geom.periodicity());
         const int ncomp = mf.nComp();
         const int ng1 = 1;
         const int ng2 = 2;
-        MultiTab tmpmf(mf.boxArray(), mf.DistributionMap(), ncomp, ng1);
+        MF tmpmf(mf.boxArray(), mf.DistributionMap(), ncomp, ng1);
         tmpmf.ParallelCopy(mf,0,0,ncomp,ng2,ng1,geom.periodicity());
         mf.ParallelCopy   (tmpmf, 0, 0, ncomp, ng1, ng2, geom.periodicity());
     }
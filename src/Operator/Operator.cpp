@@ -19,6 +19,9 @@ void Operator<Grid::Node>::Diagonal (bool recompute)
     if ( !recompute && m_diagonal_computed ) return;
     m_diagonal_computed = true;
 
+    // Eigenvalue estimates for the Chebyshev smoother depend on the diagonal
+    for (auto &lev : m_lambda_max) for (auto &lambda : lev) lambda = -1.0;
+
     for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
     {
         for (int mglev = 0; mglev < m_num_mg_levels[amrlev]; ++mglev)
@@ -31,55 +34,149 @@ void Operator<Grid::Node>::Diagonal (bool recompute)
 void Operator<Grid::Node>::Diagonal (int amrlev, int mglev, amrex::MultiFab &diag)
 {
     BL_PROFILE("Operator::Diagonal()");
-    //Util::Message(INFO);
+
+    // If there is no diagonal kernel, fall back on probing with Fapply
+    if (!HasDiag())
+    {
+        DiagonalColored(amrlev,mglev,diag);
+        return;
+    }
+
+    amrex::Box domain(m_geom[amrlev][mglev].Domain());
+    domain.convert(amrex::IntVect::TheNodeVector());
+
+    for (MFIter mfi(diag, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        Box bx = mfi.tilebox();
+        bx.grow(1);        // Expand to cover first layer of ghost nodes
+        bx = bx & domain;  // Take intersection of box and the problem domain
+
+        amrex::Array4<amrex::Real> const& D = diag.array(mfi);
+        Diag(amrlev,mglev,mfi,bx,D);
+    }
+}
+
+//
+// Compute the diagonal by applying the operator to unit probes.
+// Nodes are colored with period "stride" in each direction, so that no two
+// nodes of the same color lie within each other's stencil (stride 3 is
+// safe for any stencil of radius 1, which covers all of the node operators).
+// Every color is probed on all fabs at once, so only stride^d x ncomp
+// calls to Fapply are needed regardless of the number of boxes.
+// The components at a node are coupled, so they cannot share a probe; instead
+// the response to one probe is collected in the same pass that sets the next.
+//
+void Operator<Grid::Node>::DiagonalColored (int amrlev, int mglev, amrex::MultiFab &diag, int stride) const
+{
+    BL_PROFILE("Operator::DiagonalColored()");
+
+    amrex::Box domain(m_geom[amrlev][mglev].Domain());
+    domain.convert(amrex::IntVect::TheNodeVector());
 
     int ncomp = diag.nComp();
-    int nghost = 0;
+    int nghost = getNGrow(amrlev,mglev);
+    int ncolors = AMREX_D_TERM(stride,*stride,*stride);
+    int nprobes = ncolors*ncomp;
+
+    amrex::MultiFab x(diag.boxArray(), diag.DistributionMap(), ncomp, nghost);
+    amrex::MultiFab Ax(diag.boxArray(), diag.DistributionMap(), ncomp, nghost);
+    Ax.setVal(0.0);
+    diag.setVal(0.0);
+
+    // Probe number "probe" sets component probe % ncomp at color probe / ncomp.
+    // Pass number "pass" collects probe pass-1 (if any) and sets probe pass.
+    for (int pass = 0; pass <= nprobes; pass++)
+    {
+        const int set = pass < nprobes ? pass : -1, get = pass - 1;
+        const int nset = set % ncomp, cset = set / ncomp;
+        const int nget = get % ncomp, cget = get / ncomp;
+
+        for (MFIter mfi(x, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            // Set the probe on the whole fab, including ghost nodes, so that
+            // every fab sees the same pattern without a FillBoundary.
+            Box bx = mfi.growntilebox(nghost);
+            Box gbx = mfi.tilebox();
+            gbx.grow(1);
+            gbx = gbx & domain;
+            amrex::Array4<amrex::Real> const& X        = x.array(mfi);
+            amrex::Array4<amrex::Real> const& D        = diag.array(mfi);
+            amrex::Array4<const amrex::Real> const& AX = Ax.const_array(mfi);
+            amrex::ParallelFor (bx,[=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                    const int color = AMREX_D_TERM(((i % stride) + stride) % stride,
+                                                   + stride * (((j % stride) + stride) % stride),
+                                                   + stride * stride * (((k % stride) + stride) % stride));
+                    if (get >= 0 && color == cget && gbx.contains(amrex::IntVect(AMREX_D_DECL(i,j,k)))) D(i,j,k,nget) = AX(i,j,k,nget);
+                    for (int m = 0; m < ncomp; m++)
+                        X(i,j,k,m) = (set >= 0 && m == nset && color == cset) ? 1.0 : 0.0;
+                });
+        }
+
+        if (set >= 0) Fapply(amrlev,mglev,Ax,x);
+    }
+}
+
+//
+// Reference implementation: probe one fab at a time with stride 2.
+// This requires nfabs x 2^d x ncomp calls to Fapply, so it is only
+// intended for checking the other methods.
+//
+void Operator<Grid::Node>::DiagonalProbe (int amrlev, int mglev, amrex::MultiFab &diag) const
+{
+    BL_PROFILE("Operator::DiagonalProbe()");
+
+    amrex::Box domain(m_geom[amrlev][mglev].Domain());
+    domain.convert(amrex::IntVect::TheNodeVector());
+
+    int ncomp = diag.nComp();
+    int nghost = getNGrow(amrlev,mglev);
 
     int sep = 2;
     int num = AMREX_D_TERM(sep,*sep,*sep);
-    int cntr = 0;
 
-    amrex::MultiFab x(m_diag[amrlev][mglev]->boxArray(), m_diag[amrlev][mglev]->DistributionMap(), ncomp, nghost);
-    amrex::MultiFab Ax(m_diag[amrlev][mglev]->boxArray(), m_diag[amrlev][mglev]->DistributionMap(), ncomp, nghost);
+    amrex::MultiFab x(diag.boxArray(), diag.DistributionMap(), ncomp, nghost);
+    amrex::MultiFab Ax(diag.boxArray(), diag.DistributionMap(), ncomp, nghost);
+    diag.setVal(0.0);
 
-    for (MFIter mfi(x, false); mfi.isValid(); ++mfi)
+    for (MFIter mfi(diag, false); mfi.isValid(); ++mfi)
     {
-        const Box& bx = mfi.validbox();
-        amrex::FArrayBox       &diagfab = diag[mfi];
-        amrex::FArrayBox       &xfab    = x[mfi];
-        amrex::FArrayBox       &Axfab   = Ax[mfi];
+        Box bx = mfi.validbox();
+        bx.grow(1);
+        bx = bx & domain;
+
+        amrex::FArrayBox &diagfab = diag[mfi];
+        amrex::FArrayBox &xfab    = x[mfi];
+        amrex::FArrayBox &Axfab   = Ax[mfi];
 
-        diagfab.setVal(0.0);
-                
         for (int i = 0; i < num; i++)
         {
+            AMREX_D_TERM(const int c1 = i % sep;,
+                         const int c2 = (i / sep) % sep;,
+                         const int c3 = i / (sep*sep););
             for (int n = 0; n < ncomp; n++)
             {
-                xfab.setVal(0.0);
-                Axfab.setVal(0.0);
-                
-                //BL_PROFILE_VAR("Operator::Part1", part1); 
+                x.setVal(0.0);
+                Ax.setVal(0.0);
+
                 AMREX_D_TERM(for (int m1 = bx.loVect()[0]; m1<=bx.hiVect()[0]; m1++),
                         for (int m2 = bx.loVect()[1]; m2<=bx.hiVect()[1]; m2++),
                         for (int m3 = bx.loVect()[2]; m3<=bx.hiVect()[2]; m3++))
                 {
                     amrex::IntVect m(AMREX_D_DECL(m1,m2,m3));
-                
-                    if ( m1%sep == i/sep   &&   m2%sep == i%sep ) xfab(m,n) = 1.0;
-                    else xfab(m,n) = 0.0;
+                    if (AMREX_D_TERM(((m1 % sep) + sep) % sep == c1,
+                                     && ((m2 % sep) + sep) % sep == c2,
+                                     && ((m3 % sep) + sep) % sep == c3)) xfab(m,n) = 1.0;
                 }
-                //BL_PROFILE_VAR_STOP(part1);
 
-                BL_PROFILE_VAR("Operator::Part2", part2); 
-                Util::Message(INFO,"Calling fapply...",cntr++);
                 Fapply(amrlev,mglev,Ax,x);
-                BL_PROFILE_VAR_STOP(part2);
-                        
-                //BL_PROFILE_VAR("Operator::Part3", part3); 
-                Axfab.mult(xfab,n,n,1);
-                diagfab.plus(Axfab,n,n,1);
-                //BL_PROFILE_VAR_STOP(part3);
+
+                AMREX_D_TERM(for (int m1 = bx.loVect()[0]; m1<=bx.hiVect()[0]; m1++),
+                        for (int m2 = bx.loVect()[1]; m2<=bx.hiVect()[1]; m2++),
+                        for (int m3 = bx.loVect()[2]; m3<=bx.hiVect()[2]; m3++))
+                {
+                    amrex::IntVect m(AMREX_D_DECL(m1,m2,m3));
+                    if (xfab(m,n) != 0.0) diagfab(m,n) = Axfab(m,n);
+                }
             }
         }
     }
@@ -89,73 +186,190 @@ void Operator<Grid::Node>::Fsmooth (int amrlev, int mglev, amrex::MultiFab& x, c
 {
     BL_PROFILE("Operator::Fsmooth()");
 
-    amrex::Box domain(m_geom[amrlev][mglev].Domain());
-
-    int ncomp = b.nComp();
-    int nghost = 2; //b.nGrow();
-    
-
-    amrex::MultiFab Ax(x.boxArray(), x.DistributionMap(), ncomp, nghost);
-    amrex::MultiFab Dx(x.boxArray(), x.DistributionMap(), ncomp, nghost);
-    amrex::MultiFab Rx(x.boxArray(), x.DistributionMap(), ncomp, nghost);
-    
     if (!m_diagonal_computed) Util::Abort(INFO,"Operator::Diagonal() must be called before using Fsmooth");
 
-    // This is a JACOBI iteration, not Gauss-Seidel.
-    // So we need to do twice the number of iterations to get the same behavior as GS.
-    for (int ctr = 0; ctr < 2; ctr++)
+    amrex::MultiFab &Ax = SmootherScratch(amrlev,mglev,0);
+
+    //
+    // No communication takes place between sweeps: the first layer of
+    // ghost nodes is relaxed along with the valid nodes (and the second
+    // layer zeroed), and the ghost nodes are only synchronized at the end.
+    //
+    if (m_smoother == Smoother::Chebyshev)
+    {
+        int degree = m_smoother_sweeps > 0 ? m_smoother_sweeps : 4;
+        SmoothChebyshev(amrlev,mglev,x,b,degree);
+    }
+    else if (m_smoother == Smoother::MulticolorGS)
     {
-        Fapply(amrlev,mglev,Ax,x); // find Ax
+        // The nodal stencils couple diagonal neighbors, so red-black
+        // ordering is not enough: nodes of one of the 2^d colors
+        // (i&1, j&1, k&1) only couple to nodes of other colors. The
+        // residual is recomputed before each color.
+        int sweeps = m_smoother_sweeps > 0 ? m_smoother_sweeps : 1;
+        for (int ctr = 0; ctr < sweeps; ctr++)
+            for (int color = 0; color < AMREX_D_TERM(2,*2,*2); color++)
+            {
+                Fapply(amrlev,mglev,Ax,x);
+                RelaxNodes(amrlev,mglev,x,b,Ax,1.0,color);
+            }
+    }
+    else
+    {
+        // This is a JACOBI iteration, not Gauss-Seidel.
+        // So we need to do twice the number of iterations to get the same behavior as GS.
+        int sweeps = m_smoother_sweeps > 0 ? m_smoother_sweeps : 2;
+        for (int ctr = 0; ctr < sweeps; ctr++)
+        {
+            Fapply(amrlev,mglev,Ax,x); // find Ax
+            RelaxNodes(amrlev,mglev,x,b,Ax,m_omega,-1);
+        }
+    }
 
-        amrex::MultiFab::Copy(Dx,x,0,0,ncomp,nghost); // Dx = x
-        amrex::MultiFab::Multiply(Dx,*m_diag[amrlev][mglev],0,0,ncomp,nghost); // Dx *= diag  (Dx = x*diag)
+    amrex::Geometry geom = m_geom[amrlev][mglev];
+    realFillBoundary(x,geom);
+    nodalSync(amrlev, mglev, x);
+}
 
-        amrex::MultiFab::Copy(Rx,Ax,0,0,ncomp,nghost); // Rx = Ax
-        amrex::MultiFab::Subtract(Rx,Dx,0,0,ncomp,nghost); // Rx -= Dx  (Rx = Ax - Dx)
+void Operator<Grid::Node>::RelaxNodes (int amrlev, int mglev, amrex::MultiFab& a_x, const amrex::MultiFab& a_b,
+                                       const amrex::MultiFab& a_Ax, Set::Scalar omega, int color) const
+{
+    BL_PROFILE("Operator::RelaxNodes()");
+    amrex::Box domain(m_geom[amrlev][mglev].Domain());
+    domain.convert(amrex::IntVect::TheNodeVector());
+    const int ncomp = a_b.nComp();
 
-        for (MFIter mfi(x, false); mfi.isValid(); ++mfi)
-        {
-            const Box& bx = mfi.validbox();
-            amrex::FArrayBox       &xfab    = x[mfi];
-            const amrex::FArrayBox &bfab    = b[mfi];
-            //const amrex::FArrayBox &Axfab   = Ax[mfi];
-            const amrex::FArrayBox &Rxfab   = Rx[mfi];
-            const amrex::FArrayBox &diagfab = (*m_diag[amrlev][mglev])[mfi];
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(a_x, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box bx = mfi.growntilebox(2) & domain;   // skip ghost nodes outside problem domain
+        const Box inner = amrex::grow(mfi.validbox(),1);
+        amrex::Array4<amrex::Real> const& x = a_x.array(mfi);
+        amrex::Array4<const amrex::Real> const& b = a_b.array(mfi);
+        amrex::Array4<const amrex::Real> const& Ax = a_Ax.array(mfi);
+        amrex::Array4<const amrex::Real> const& diag = m_diag[amrlev][mglev]->array(mfi);
 
-            for (int n = 0; n < ncomp; n++)
+        amrex::ParallelFor (bx, ncomp, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) {
+            if (!inner.contains(amrex::IntVect(AMREX_D_DECL(i,j,k))))
             {
-                AMREX_D_TERM(for (int m1 = bx.loVect()[0] - 2; m1<=bx.hiVect()[0] + 2; m1++),
-                        for (int m2 = bx.loVect()[1] - 2; m2<=bx.hiVect()[1] + 2; m2++),
-                        for (int m3 = bx.loVect()[2] - 2; m3<=bx.hiVect()[2] + 2; m3++))
-                {
+                x(i,j,k,n) = 0.0;
+                return;
+            }
+            if (color >= 0 && (AMREX_D_TERM((i&1), + 2*(j&1), + 4*(k&1))) != color) return;
+            Set::Scalar Rx = Ax(i,j,k,n) - x(i,j,k,n)*diag(i,j,k,n);   // off-diagonal part of Ax
+            x(i,j,k,n) = (1.-omega)*x(i,j,k,n) + omega*(b(i,j,k,n) - Rx)/diag(i,j,k,n);
+        });
+    }
+}
 
-                    amrex::IntVect m(AMREX_D_DECL(m1,m2,m3));
+void Operator<Grid::Node>::SmoothChebyshev (int amrlev, int mglev, amrex::MultiFab& a_x, const amrex::MultiFab& a_b, int degree) const
+{
+    BL_PROFILE("Operator::SmoothChebyshev()");
+    amrex::MultiFab &a_Ax = SmootherScratch(amrlev,mglev,0);
+    amrex::MultiFab &a_d  = SmootherScratch(amrlev,mglev,1);
+
+    const Set::Scalar lambda_max = LambdaMax(amrlev,mglev);
+    const Set::Scalar upper = 1.1*lambda_max, lower = m_chebyshev_ratio*lambda_max;
+    const Set::Scalar theta = 0.5*(upper+lower), delta = 0.5*(upper-lower);
+    const Set::Scalar sigma = theta/delta;
+    Set::Scalar rho = 1.0/sigma;
+
+    amrex::Box domain(m_geom[amrlev][mglev].Domain());
+    domain.convert(amrex::IntVect::TheNodeVector());
+    const int ncomp = a_b.nComp();
+
+    for (int iter = 0; iter < degree; iter++)
+    {
+        // d_0 = D^-1 r / theta;   d_k = rho_k rho_{k-1} d_{k-1} + 2 rho_k/delta D^-1 r
+        Set::Scalar rho_new = (iter == 0) ? rho : 1.0/(2.0*sigma - rho);
+        Set::Scalar alpha = (iter == 0) ? 0.0 : rho_new*rho;
+        Set::Scalar beta  = (iter == 0) ? 1.0/theta : 2.0*rho_new/delta;
+
+        Fapply(amrlev,mglev,a_Ax,a_x);
 
-                    // Skip ghost cells outside problem domain
-                    if (AMREX_D_TERM(m[0] < domain.loVect()[0], ||
-                            m[1] < domain.loVect()[1], ||
-                            m[2] < domain.loVect()[2])) continue;
-                    if (AMREX_D_TERM(m[0] > domain.hiVect()[0] + 1, ||
-                            m[1] > domain.hiVect()[1] + 1, ||
-                            m[2] > domain.hiVect()[2] + 1)) continue;
-
-                    if (AMREX_D_TERM(m[0] == bx.loVect()[0] - nghost || m[0] == bx.hiVect()[0] + nghost, ||
-                            m[1] == bx.loVect()[1] - nghost || m[1] == bx.hiVect()[1] + nghost, ||
-                            m[2] == bx.loVect()[2] - nghost || m[2] == bx.hiVect()[2] + nghost))
-                    {
-                        xfab(m,n) = 0.0;
-                        continue;
-                    }
-
-                    //xfab(m,n) = xfab(m,n) + omega*(bfab(m,n) - Axfab(m,n))/diagfab(m,n);
-                    xfab(m,n) = (1.-m_omega)*xfab(m,n) + m_omega*(bfab(m,n) - Rxfab(m,n))/diagfab(m,n);
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(a_x, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box bx = mfi.growntilebox(2) & domain;
+            const Box inner = amrex::grow(mfi.validbox(),1);
+            amrex::Array4<amrex::Real> const& x = a_x.array(mfi);
+            amrex::Array4<amrex::Real> const& d = a_d.array(mfi);
+            amrex::Array4<const amrex::Real> const& b = a_b.array(mfi);
+            amrex::Array4<const amrex::Real> const& Ax = a_Ax.array(mfi);
+            amrex::Array4<const amrex::Real> const& diag = m_diag[amrlev][mglev]->array(mfi);
+
+            amrex::ParallelFor (bx, ncomp, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) {
+                if (!inner.contains(amrex::IntVect(AMREX_D_DECL(i,j,k))))
+                {
+                    x(i,j,k,n) = 0.0;
+                    d(i,j,k,n) = 0.0;
+                    return;
                 }
-            }
+                Set::Scalar dold = (iter == 0) ? 0.0 : d(i,j,k,n);
+                d(i,j,k,n) = alpha*dold + beta*(b(i,j,k,n) - Ax(i,j,k,n))/diag(i,j,k,n);
+                x(i,j,k,n) += d(i,j,k,n);
+            });
         }
+        rho = rho_new;
     }
-    amrex::Geometry geom = m_geom[amrlev][mglev];
-    realFillBoundary(x,geom);
-    nodalSync(amrlev, mglev, x);
+}
+
+Set::Scalar Operator<Grid::Node>::LambdaMax (int amrlev, int mglev) const
+{
+    if (m_lambda_max[amrlev][mglev] > 0.0) return m_lambda_max[amrlev][mglev];
+    BL_PROFILE("Operator::LambdaMax()");
+
+    amrex::MultiFab &w = SmootherScratch(amrlev,mglev,0);
+    amrex::MultiFab &v = SmootherScratch(amrlev,mglev,1);
+    amrex::Box domain(m_geom[amrlev][mglev].Domain());
+    domain.convert(amrex::IntVect::TheNodeVector());
+    const int ncomp = v.nComp();
+
+    // Deterministic, non-smooth starting vector
+    v.setVal(0.0);
+    for (MFIter mfi(v, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box bx = mfi.tilebox();
+        amrex::Array4<amrex::Real> const& V = v.array(mfi);
+        amrex::ParallelFor (bx, ncomp, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) {
+            V(i,j,k,n) = 1.0 + (Set::Scalar)(((AMREX_D_TERM(7*i,+13*j,+17*k) + 3*n) % 11 + 11) % 11)/11.0;
+        });
+    }
+
+    Set::Scalar lambda = 1.0;
+    for (int iter = 0; iter < 10; iter++)
+    {
+        Set::Scalar vnorm = v.norm2(0,ncomp,m_geom[amrlev][mglev].periodicity());
+        v.mult(1.0/vnorm);
+        realFillBoundary(v,m_geom[amrlev][mglev]);
+        Fapply(amrlev,mglev,w,v);
+        for (MFIter mfi(w, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box bx = mfi.tilebox() & domain;
+            amrex::Array4<amrex::Real> const& W = w.array(mfi);
+            amrex::Array4<amrex::Real> const& V = v.array(mfi);
+            amrex::Array4<const amrex::Real> const& diag = m_diag[amrlev][mglev]->array(mfi);
+            amrex::ParallelFor (bx, ncomp, [=] AMREX_GPU_DEVICE(int i, int j, int k, int n) {
+                V(i,j,k,n) = W(i,j,k,n)/diag(i,j,k,n);
+            });
+        }
+        lambda = v.norm2(0,ncomp,m_geom[amrlev][mglev].periodicity());
+    }
+    m_lambda_max[amrlev][mglev] = lambda;
+    return lambda;
+}
+
+amrex::MultiFab & Operator<Grid::Node>::SmootherScratch (int amrlev, int mglev, int which) const
+{
+    std::unique_ptr<amrex::MultiFab> &mf = m_smooth_scratch[which][amrlev][mglev];
+    if (!mf)
+        mf.reset(new MultiFab(amrex::convert(m_grids[amrlev][mglev], amrex::IntVect::TheNodeVector()),
+                              m_dmap[amrlev][mglev], getNComp(), 2));
+    return *mf;
 }
 
 void Operator<Grid::Node>::normalize (int amrlev, int mglev, MultiFab& a_x) const
@@ -247,6 +461,19 @@ void Operator<Grid::Node>::define (const Vector<Geometry>& a_geom,
         }
     }
 
+    // Smoother scratch space is allocated on first use
+    for (int which = 0; which < 2; which++)
+    {
+        m_smooth_scratch[which].clear();
+        m_smooth_scratch[which].resize(m_num_amr_levels);
+        for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
+            m_smooth_scratch[which][amrlev].resize(m_num_mg_levels[amrlev]);
+    }
+    m_lambda_max.clear();
+    m_lambda_max.resize(m_num_amr_levels);
+    for (int amrlev = 0; amrlev < m_num_amr_levels; ++amrlev)
+        m_lambda_max[amrlev].resize(m_num_mg_levels[amrlev],-1.0);
+
     // We need to instantiate the m_lobc objects.
     // WE DO NOT USE THEM - our BCs are implemented differently.
     // But they need to be the right size or the code will segfault.
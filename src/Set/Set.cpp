@@ -1,22 +1,48 @@
 #include "Set.H"
 #include <random>
+#include <sstream>
+#include <cstdlib>
 namespace Set
 {
 }
 
 namespace Util
 {
+//
+// One std::mt19937 for Random and Gaussian, so that its state can be stored
+// in and restored from checkpoints with the standard stream operators.
+//
+static std::mt19937 &GetGenerator()
+{
+    static std::mt19937 generator;
+    return generator;
+}
+void Seed(unsigned int seed)
+{
+    srand(seed); // for Eigen's Random(), which uses rand()
+    GetGenerator().seed(seed);
+}
 Set::Scalar Random()
 {
-    return ((Set::Scalar) rand()) / ((Set::Scalar) RAND_MAX);
+    return ((Set::Scalar) GetGenerator()()) / ((Set::Scalar) std::mt19937::max());
 }
 Set::Scalar Gaussian(amrex::Real mean,amrex::Real std_deviation)
 {
-    std::random_device randomness_device{};
-    std::mt19937 pseudorandom_generator{randomness_device()};
     std::normal_distribution<double> distribution{mean, std_deviation};
-    auto sample = distribution(pseudorandom_generator);
+    auto sample = distribution(GetGenerator());
     return sample;
 }
+std::string RandomState()
+{
+    std::ostringstream os;
+    os << GetGenerator();
+    return os.str();
+}
+void RandomState(const std::string &state)
+{
+    std::istringstream is(state);
+    is >> GetGenerator();
+    if (is.fail()) Util::Abort(INFO,"Could not restore the random number generator state");
+}
 
 }
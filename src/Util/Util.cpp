@@ -87,14 +87,26 @@ void Initialize ()
 }
 void Initialize (int argc, char* argv[])
 {
-    srand (time(NULL));
+    Util::Seed(time(NULL));
 
-    amrex::Initialize(argc, argv);
+    // Asynchronous plotfile output is handled by amrex::AsyncOut, which
+    // must be switched on before amrex is initialized.
+    amrex::Initialize(argc, argv, true, MPI_COMM_WORLD, [](){
+        amrex::ParmParse pp_amr("amr");
+        int plot_async = 0;
+        pp_amr.query("plot_async",plot_async);
+        if (plot_async) amrex::ParmParse("amrex").add("async_out",1);
+    });
 
     amrex::ParmParse pp_amrex("amrex");
     pp_amrex.add("throw_exception",1);
     //amrex.throw_exception=1
 
+    amrex::ParmParse pp_numeric("numeric");
+    pp_numeric.query("boundary_order",Numeric::BoundaryOrder); // Order (1 or 2) of one-sided stencils at box edges (Numeric::ParallelForStencil loops)
+    if (Numeric::BoundaryOrder != 1 && Numeric::BoundaryOrder != 2)
+        Util::Abort(INFO,"numeric.boundary_order must be 1 or 2, but got ",Numeric::BoundaryOrder);
+
     signal(SIGSEGV, Util::SignalHandler);
     signal(SIGINT,  Util::SignalHandler);
     signal(SIGABRT, Util::SignalHandler);
@@ -33,7 +33,7 @@ int main (int argc, char* argv[])
 
     if (program == "microstructure")
     {
-        srand(2);
+        Util::Seed(2);
         Integrator::Integrator *pfm = new Integrator::PhaseFieldMicrostructure();
         //Integrator::PhaseFieldMicrostructure pfm;
         pfm->InitData();
@@ -112,19 +112,25 @@ int main (int argc, char* argv[])
     }
     else if (program == "degradation")
     {
-        srand(1.0*amrex::ParallelDescriptor::MyProc());
+        Util::Seed(amrex::ParallelDescriptor::MyProc());
         Integrator::PolymerDegradation model;
         model.InitData();
         model.Evolve();
     }
     else if (program == "fracture")
     {
-        srand(1.0*amrex::ParallelDescriptor::MyProc());
+        Util::Seed(amrex::ParallelDescriptor::MyProc());
         Integrator::Fracture model;
         model.InitData();
         model.Evolve();
         //delete model;
     }
+    else if (program == "cahnhilliard")
+    {
+        Integrator::CahnHilliard model;
+        model.InitData();
+        model.Evolve();
+    }
     else if (program == "thermoelastic")
     {
         IO::ParmParse pp;
@@ -0,0 +1,848 @@
+//
+// Microbenchmarks for the nodal elastic operator and solver, and for the
+// kernels underneath them. The suites listed in :code:`bench.suites` are run
+// (default: all of them).
+//
+// :code:`operator`: synthetic single- and two-level node grids are built for
+// each box size in :code:`bench.box_sizes` and each material model, and the
+// following kernels are timed:
+//
+// * :code:`fapply` - operator application on every level
+// * :code:`fapply.virtual_bc` - the same, with the boundary conditions
+//   evaluated through the virtual BC call rather than descriptors
+// * :code:`diagonal` - diagonal computation on every level
+// * :code:`fsmooth` - one smoother call on every level
+// * :code:`vcycle` - a full MLMG solve with a single fixed V-cycle
+// * :code:`vcycle.gs`, :code:`fsmooth.gs`, :code:`vcycle.chebyshev`,
+//   :code:`fsmooth.chebyshev` - the same with the multicolor Gauss-Seidel and
+//   Chebyshev smoothers (the others use the default Jacobi smoother)
+//
+// :code:`contraction`: :code:`bench.contractions` contractions C*b of a
+// random Matrix4 of each symmetry, with the unrolled operator
+// (:code:`contraction.unrolled`) and with a loop over operator() whose bounds
+// are only known at runtime (:code:`contraction.indexed`).
+//
+// :code:`psread`: a random pack of :code:`bench.psread.spheres` spheres on a
+// :code:`bench.psread.n_cell` grid is evaluated with the spatial hash used by
+// IC::PSRead (:code:`psread.hash`) and by brute force over all spheres
+// (:code:`psread.bruteforce`).
+//
+// :code:`voronoi`: a tessellation of :code:`bench.voronoi.grains` random seeds
+// on a :code:`bench.voronoi.n_cell` grid is built with the bucket grid of
+// IC::Voronoi (:code:`voronoi.bucket`, including setup) and by brute force over
+// all seeds (:code:`voronoi.bruteforce`).
+//
+// :code:`stencil`: Gradient, Hessian and Laplacian of a random cell field on
+// a :code:`bench.stencil.n_cell` grid, with a ParallelFor that calls
+// GetStencil at every point (:code:`stencil.runtime`) and with the
+// interior/boundary split of Numeric::ParallelForStencil
+// (:code:`stencil.split`).
+//
+// :code:`spectral`: the tensile part of a random symmetric strain field on a
+// 64^d box, with Eigen's SelfAdjointEigenSolver (:code:`spectral.eigen`),
+// with the pointwise closed form (:code:`spectral.closedform`) and with the
+// batched closed form (:code:`spectral.batched`) of Numeric::SpectralSplit.
+//
+// :code:`microstructure`: the PhaseFieldMicrostructure integrator with
+// :code:`bench.microstructure.grains` Voronoi grains on a
+// :code:`bench.microstructure.n_cell` grid is run for
+// :code:`bench.microstructure.steps` steps with dense (:code:`microstructure.dense`)
+// and sparse (:code:`microstructure.sparse`) grain storage. The items are
+// cell updates. Integrator output goes to :code:`plot_file` (default
+// :code:`bench_output`).
+//
+// :code:`plotfile`: a 20-grain PhaseFieldMicrostructure run on a
+// :code:`bench.plotfile.n_cell` grid that writes a plotfile at each of its
+// :code:`bench.plotfile.steps` steps, synchronously (:code:`plotfile.sync`) and
+// with :code:`amr.plot_async` (:code:`plotfile.async`, only if the benchmark is
+// run with :code:`amrex.async_out=1`). The difference is the time saved by
+// writing in the background.
+//
+// Results (ns/node, GFLOP/s, GB/s) are written as a JSON array to
+// :code:`bench.output` (default :code:`bench.json`; use :code:`-` for stdout,
+// which also carries the AMReX banner and progress messages). Flop and byte counts are nominal
+// per-node estimates for the stencil, not hardware counters: they are meant
+// for comparing runs, not for roofline analysis. The V-cycle is reported in
+// ns/node only. Kernels that do not run on a grid report levels = 0,
+// box_size = 0 and, in place of nodes, the number of items processed
+// (e.g. contractions or cells); ns_per_node is then the time per item.
+//
+// Example:
+//
+//     mpirun -np 4 ./bin/bench-3d-g++ bench.n_cell=64 bench.box_sizes="16 32"
+//
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <tuple>
+
+#include <AMReX.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_FArrayBox.H>
+#include <AMReX_AsyncOut.H>
+#include <AMReX_Utility.H>
+#include <eigen3/Eigen/Dense>
+
+#include "Util/Util.H"
+#include "IO/ParmParse.H"
+#include "Set/Set.H"
+#include "Operator/Elastic.H"
+#include "BC/Operator/Elastic/Constant.H"
+#include "Solver/Nonlocal/Linear.H"
+#include "IC/PSRead.H"
+#include "IC/Voronoi.H"
+#include "Numeric/Stencil.H"
+#include "Numeric/Spectral.H"
+#include "Integrator/PhaseFieldMicrostructure.H"
+
+#include "Model/Solid/Linear/Isotropic.H"
+#include "Model/Solid/Linear/Cubic.H"
+#include "Model/Solid/Affine/J2.H"
+#include "Model/Solid/Elastic/NeoHookean.H"
+
+namespace Bench
+{
+
+/// The Constant BC without the face descriptors, so that the operator falls
+/// back to the virtual BC calls
+class VirtualConstant : public ::BC::Operator::Elastic::Constant
+{
+public:
+    virtual bool GetDescriptor (const Face, Descriptor &) const override {return false;}
+};
+
+struct Options
+{
+    int n_cell = 32;                    // coarse level cells per direction
+    std::vector<int> box_sizes;         // max grid sizes to sweep
+    std::vector<int> levels = {1,2};    // number of AMR levels to sweep
+    int repeat = 10;                    // repetitions per kernel
+    int nmaterials = 16;                // distinct random moduli per grid
+    long contractions = 10000000;       // Matrix4 contractions per symmetry
+    int psread_spheres = 2000;          // spheres in the random pack
+    int psread_n_cell = 128;            // cells per direction for the pack
+    int stencil_n_cell = AMREX_D_PICK(0,1024,128); // cells per direction for the stencils
+    int voronoi_grains = 10000;         // seeds in the Voronoi tessellation
+    int voronoi_n_cell = AMREX_D_PICK(0,256,64); // cells per direction for the Voronoi tessellation
+    int microstructure_grains = 500;    // grains in the microstructure runs
+    int microstructure_n_cell = AMREX_D_PICK(0,256,64); // cells per direction for the microstructure runs
+    int microstructure_steps = 10;      // timesteps per microstructure run
+    int plotfile_n_cell = AMREX_D_PICK(0,128,32); // cells per direction for the plotfile runs
+    int plotfile_steps = 20;            // timesteps (and plotfiles) per plotfile run
+};
+
+struct Record
+{
+    std::string kernel, model;
+    int levels, box_size;
+    long nodes;
+    Set::Scalar ns_per_node, gflops, gbytes_per_s;
+};
+
+/// Random instance of a model. Affine::J2 has no Random of its own, so its
+/// isotropic part is randomized and a yield stress is drawn separately.
+template<class MODEL> MODEL Sample() { return MODEL::Random(); }
+template<> Model::Solid::Affine::J2 Sample<Model::Solid::Affine::J2>()
+{
+    Model::Solid::Affine::J2 ret;
+    Model::Solid::Affine::Isotropic &base = ret;
+    base = Model::Solid::Affine::Isotropic::Random();
+    ret.sigma0 = Util::Random();
+    return ret;
+}
+
+/// Time `repeat` calls to `f`, synchronized across ranks, in seconds per call
+template<class F>
+Set::Scalar Time(int repeat, F &&f)
+{
+    amrex::ParallelDescriptor::Barrier();
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) f();
+    amrex::ParallelDescriptor::Barrier();
+    return std::chrono::duration<Set::Scalar>(std::chrono::steady_clock::now()-start).count() / repeat;
+}
+
+template<class MODEL>
+void Run(std::string name, const Options &opt, int nlevels, int box_size, std::vector<Record> &records)
+{
+    BL_PROFILE("Bench::Run");
+    using MATRIX4 = Set::Matrix4<AMREX_SPACEDIM,MODEL::sym>;
+    const int d = AMREX_SPACEDIM;
+
+    //
+    // Grids: the coarse level covers the domain and each finer level
+    // refines the central half of the one below it.
+    //
+    amrex::Vector<amrex::Geometry> geom(nlevels);
+    amrex::Vector<amrex::BoxArray> grids(nlevels);
+    amrex::Vector<amrex::DistributionMapping> dmap(nlevels);
+    amrex::Box domain(amrex::IntVect::TheZeroVector(), amrex::IntVect(opt.n_cell-1));
+    amrex::Box region = domain;
+    for (int lev = 0; lev < nlevels; lev++)
+    {
+        geom[lev].define(domain);
+        grids[lev].define(region);
+        grids[lev].maxSize(box_size);
+        dmap[lev].define(grids[lev]);
+
+        domain.refine(2);
+        amrex::IntVect lo = domain.smallEnd() + domain.length()/4;
+        region = amrex::Box(lo, lo + domain.length()/2 - 1);
+    }
+
+    //
+    // Fields: per-node moduli drawn from a small table of random models
+    // evaluated at a random kinematic state near the reference.
+    //
+    std::vector<MATRIX4> table(opt.nmaterials);
+    for (auto &C : table)
+    {
+        MODEL model = Sample<MODEL>();
+        Set::Matrix arg = 0.01*Set::Matrix::Random();
+        if (MODEL::kinvar == Model::Solid::KinematicVariable::F) arg += Set::Matrix::Identity();
+        C = model.DDW(arg);
+    }
+
+    Set::Field<MATRIX4> model_field;
+    Set::Field<Set::Scalar> u, b, res, diag;
+    model_field.resize(nlevels); u.resize(nlevels); b.resize(nlevels); res.resize(nlevels); diag.resize(nlevels);
+    long nodes = 0;
+    for (int lev = 0; lev < nlevels; lev++)
+    {
+        amrex::BoxArray ngrids = grids[lev];
+        ngrids.convert(amrex::IntVect::TheNodeVector());
+        nodes += ngrids.numPts();
+        model_field.Define(lev,ngrids,dmap[lev],1,2);
+        u.Define(lev,ngrids,dmap[lev],d,2);
+        b.Define(lev,ngrids,dmap[lev],d,2);
+        res.Define(lev,ngrids,dmap[lev],d,2);
+        diag.Define(lev,ngrids,dmap[lev],d,2);
+
+        const int nmaterials = opt.nmaterials;
+        for (amrex::MFIter mfi(*model_field[lev], false); mfi.isValid(); ++mfi)
+        {
+            amrex::Box bx = mfi.growntilebox();
+            amrex::Array4<MATRIX4> const &C = model_field[lev]->array(mfi);
+            amrex::Array4<Set::Scalar> const &U = u[lev]->array(mfi);
+            amrex::LoopOnCpu(bx, [&](int i, int j, int k) {
+                    unsigned int hash = 73856093u*(unsigned int)i ^ 19349663u*(unsigned int)j ^ 83492791u*(unsigned int)k;
+                    C(i,j,k) = table[hash % nmaterials];
+                    for (int n = 0; n < d; n++) U(i,j,k,n) = Util::Random();
+                });
+        }
+        b[lev]->setVal(1.0); // nonzero so that the solver does not exit early
+        res[lev]->setVal(0.0);
+        diag[lev]->setVal(0.0);
+    }
+
+    amrex::LPInfo info;
+    Operator::Elastic<MODEL::sym> op(geom, grids, dmap, info);
+    op.SetUniform(false);
+    op.SetModel(model_field);
+    BC::Operator::Elastic::Constant bc;
+    op.SetBC(&bc);
+
+    Solver::Nonlocal::Linear solver(op);
+    solver.setFixedIter(1);
+    solver.setVerbose(0);
+
+    //
+    // Nominal per-node costs. The stencil forms grad grad u (d^2(d+1)/2
+    // second derivatives per component, ~4 flops each) and contracts it
+    // with C and with the gradient of C (~2 d^4 flops each). Traffic is one
+    // read of u, one write of the output and one read of the moduli.
+    //
+    const Set::Scalar apply_flops = 4.0*d*d*(d+1)/2.0 + 4.0*d*d*d*d;
+    const Set::Scalar apply_bytes = 2.0*d*sizeof(Set::Scalar) + sizeof(MATRIX4);
+    const Set::Scalar diag_flops  = 4.0*d*d;
+    const Set::Scalar diag_bytes  = d*sizeof(Set::Scalar) + sizeof(MATRIX4);
+    // Default Jacobi smoother: two sweeps, each an apply plus a relaxation
+    // reading b and the diagonal and updating x.
+    const Set::Scalar smooth_flops = 2.0*(apply_flops + 3.0*d);
+    const Set::Scalar smooth_bytes = 2.0*(apply_bytes + 4.0*d*sizeof(Set::Scalar));
+
+    auto record = [&](std::string kernel, Set::Scalar t, Set::Scalar flops, Set::Scalar bytes) {
+        records.push_back({kernel, name, nlevels, box_size, nodes, 1E9*t/nodes,
+                           flops*nodes/t/1E9, bytes*nodes/t/1E9});
+    };
+
+    // The V-cycle goes first: it prepares the operator (coefficient
+    // averaging, diagonal, smoother scratch) that Fsmooth relies on.
+    Set::Scalar t = Time(opt.repeat, [&]() {
+            for (int lev = 0; lev < nlevels; lev++) res[lev]->setVal(0.0);
+            solver.solve(res, b, 1E-12, 0.0);
+        });
+    record("vcycle", t, 0.0, 0.0);
+
+    t = Time(opt.repeat, [&]() {
+            for (int lev = 0; lev < nlevels; lev++) op.Apply(lev,0,*res[lev],*u[lev]);
+        });
+    record("fapply", t, apply_flops, apply_bytes);
+
+    // The same application with the boundary conditions evaluated through
+    // the virtual BC call instead of descriptors
+    VirtualConstant bc_virtual;
+    op.SetBC(&bc_virtual);
+    t = Time(opt.repeat, [&]() {
+            for (int lev = 0; lev < nlevels; lev++) op.Apply(lev,0,*res[lev],*u[lev]);
+        });
+    record("fapply.virtual_bc", t, apply_flops, apply_bytes);
+    op.SetBC(&bc);
+
+    t = Time(opt.repeat, [&]() {
+            for (int lev = 0; lev < nlevels; lev++) op.ComputeDiagonal(lev,0,*diag[lev]);
+        });
+    record("diagonal", t, diag_flops, diag_bytes);
+
+    t = Time(opt.repeat, [&]() {
+            for (int lev = 0; lev < nlevels; lev++) op.Smooth(lev,0,*u[lev],*b[lev]);
+        });
+    record("fsmooth", t, smooth_flops, smooth_bytes);
+
+    // The other smoothers, with their default sweeps: multicolor GS does an
+    // apply and a relaxation per color, Chebyshev an apply and an update of
+    // x and the search direction per degree.
+    const int ncolors = AMREX_D_TERM(2,*2,*2);
+    const std::vector<std::tuple<std::string,Set::Scalar,Set::Scalar>> smoothers = {
+        {"gs",        ncolors*(apply_flops + 3.0*d), ncolors*(apply_bytes + 4.0*d*sizeof(Set::Scalar))},
+        {"chebyshev", 4.0*(apply_flops + 5.0*d),     4.0*(apply_bytes + 6.0*d*sizeof(Set::Scalar))}};
+    for (const auto &smoother : smoothers)
+    {
+        op.SetSmoother(std::get<0>(smoother));
+        t = Time(opt.repeat, [&]() {
+                for (int lev = 0; lev < nlevels; lev++) res[lev]->setVal(0.0);
+                solver.solve(res, b, 1E-12, 0.0);
+            });
+        record("vcycle." + std::get<0>(smoother), t, 0.0, 0.0);
+
+        t = Time(opt.repeat, [&]() {
+                for (int lev = 0; lev < nlevels; lev++) op.Smooth(lev,0,*u[lev],*b[lev]);
+            });
+        record("fsmooth." + std::get<0>(smoother), t, std::get<1>(smoother), std::get<2>(smoother));
+    }
+    op.SetSmoother("jacobi");
+}
+
+/// Record for a kernel timed over `items` independent items rather than
+/// over the nodes of a grid
+void RecordItems(std::string kernel, std::string model, long items, Set::Scalar t, std::vector<Record> &records)
+{
+    records.push_back({kernel, model, 0, 0, items, 1E9*t/items, 0.0, 0.0});
+}
+
+/// Time contractions C*b with the unrolled operator, and with a loop over
+/// operator() whose bounds are only known at runtime (so that every index
+/// goes through the component lookup). The checksums keep the compiler from
+/// discarding the loops and are compared as a sanity check.
+template<Set::Sym SYM>
+void Contraction(std::string name, const Options &opt, std::vector<Record> &records)
+{
+    BL_PROFILE("Bench::Contraction");
+    const int d = AMREX_SPACEDIM;
+    const long n = opt.contractions;
+    Set::Matrix4<AMREX_SPACEDIM,SYM> C;
+    if constexpr (SYM == Set::Sym::Isotropic || SYM == Set::Sym::Diagonal) C.Randomize();
+    else C = Set::Matrix4<AMREX_SPACEDIM,SYM>::Randomize();
+    Set::Matrix b = Set::Matrix::Random();
+    volatile int runtime_dim = d;
+    const int rdim = runtime_dim;
+
+    Set::Scalar checksum_indexed = 0.0, checksum_unrolled = 0.0;
+    Set::Scalar t = Time(1, [&]() {
+            for (long m = 0; m < n; m++)
+            {
+                Set::Matrix ret = Set::Matrix::Zero();
+                for (int i = 0; i < rdim; i++)
+                for (int j = 0; j < rdim; j++)
+                for (int k = 0; k < rdim; k++)
+                for (int l = 0; l < rdim; l++)
+                    ret(i,j) += C(i,j,k,l)*b(k,l);
+                checksum_indexed += ret.trace();
+                b(0,0) += 1E-12;
+            }
+        });
+    RecordItems("contraction.indexed", name, n, t, records);
+
+    b(0,0) -= n*1E-12;
+    t = Time(1, [&]() {
+            for (long m = 0; m < n; m++)
+            {
+                Set::Matrix ret = C*b;
+                checksum_unrolled += ret.trace();
+                b(0,0) += 1E-12;
+            }
+        });
+    RecordItems("contraction.unrolled", name, n, t, records);
+
+    if (std::fabs(checksum_indexed - checksum_unrolled) > 1E-8*std::fabs(checksum_indexed))
+        Util::Warning(INFO,name," contraction checksums differ: ",checksum_indexed," vs ",checksum_unrolled);
+}
+
+/// Time the spatial-hash evaluation of a random sphere pack by IC::PSRead,
+/// and the brute-force evaluation of the same field
+void PSRead(const Options &opt, std::vector<Record> &records)
+{
+    BL_PROFILE("Bench::PSRead");
+    const int n_cell = opt.psread_n_cell;
+    amrex::Box domain(amrex::IntVect::TheZeroVector(), amrex::IntVect(n_cell-1));
+    amrex::Vector<amrex::Geometry> geom(1);
+    geom[0].define(domain);
+    amrex::BoxArray grids(domain);
+    grids.maxSize(n_cell/2);
+    amrex::DistributionMapping dmap(grids);
+
+    std::vector<Set::Vector> X(opt.psread_spheres);
+    std::vector<Set::Scalar> R(opt.psread_spheres);
+    for (int n = 0; n < opt.psread_spheres; n++)
+    {
+        for (int d = 0; d < AMREX_SPACEDIM; d++) X[n](d) = Util::Random();
+        R[n] = 0.02 + 0.04*Util::Random();
+    }
+    IC::PSRead ic(geom);
+    ic.Define(X,R,0.01);
+
+    Set::Field<Set::Scalar> phi;
+    phi.resize(1);
+    phi.Define(0,grids,dmap,1,0);
+    const long cells = grids.numPts();
+    const std::string name = std::to_string(opt.psread_spheres) + ".spheres";
+
+    Set::Scalar t = Time(opt.repeat, [&]() { ic.Initialize(0,phi); });
+    RecordItems("psread.hash", name, cells, t, records);
+
+    Set::Scalar checksum = 0.0;
+    t = Time(1, [&]() {
+            const Set::Scalar *DX = geom[0].CellSize();
+            const Set::Scalar *LO = geom[0].ProbLo();
+            for (amrex::MFIter mfi(*phi[0], false); mfi.isValid(); ++mfi)
+                amrex::LoopOnCpu(mfi.validbox(), [&](int i, int j, int k) {
+                        Set::Vector x;
+                        AMREX_D_TERM(x(0) = LO[0] + ((Set::Scalar)i + 0.5)*DX[0];,
+                                     x(1) = LO[1] + ((Set::Scalar)j + 0.5)*DX[1];,
+                                     x(2) = LO[2] + ((Set::Scalar)k + 0.5)*DX[2];);
+                        checksum += ic.EvaluateBruteForce(x);
+                    });
+        });
+    RecordItems("psread.bruteforce", name, cells, t, records);
+
+    amrex::ParallelDescriptor::ReduceRealSum(checksum);
+    Set::Scalar sum = phi[0]->sum(0);
+    if (std::fabs(sum - checksum) > 1E-8*std::fabs(checksum))
+        Util::Warning(INFO,"PSRead hash and brute-force sums differ: ",sum," vs ",checksum);
+}
+
+/// Time the bucket-grid grain assignment of IC::Voronoi, and the
+/// brute-force search over all seeds for the same cells
+void Voronoi(const Options &opt, std::vector<Record> &records)
+{
+    BL_PROFILE("Bench::Voronoi");
+    const int n_cell = opt.voronoi_n_cell;
+    amrex::Box domain(amrex::IntVect::TheZeroVector(), amrex::IntVect(n_cell-1));
+    amrex::Vector<amrex::Geometry> geom(1);
+    geom[0].define(domain);
+    amrex::BoxArray grids(domain);
+    grids.maxSize(32);
+    amrex::DistributionMapping dmap(grids);
+
+    Set::Field<Set::Scalar> eta;
+    eta.resize(1);
+    eta.Define(0,grids,dmap,1,0);
+    const long cells = grids.numPts();
+    const int N = opt.voronoi_grains;
+    const std::string name = std::to_string(N) + ".grains";
+
+    // Each cell gets the id of its grain, so that the results can be compared
+    std::vector<Set::Scalar> ids(N);
+    for (int n = 0; n < N; n++) ids[n] = n;
+
+    // Defining the IC draws the seeds and builds the bucket grid, and the
+    // first Initialize fills the grain cache. A new IC is timed each time,
+    // since later calls would only copy from the cache.
+    std::unique_ptr<IC::Voronoi> ic;
+    Set::Scalar t = Time(opt.repeat, [&]() {
+            ic.reset(new IC::Voronoi(geom));
+            ic->Define(N, ids, IC::Voronoi::Type::Values);
+            ic->Initialize(0,eta);
+        });
+    RecordItems("voronoi.bucket", name, cells, t, records);
+
+    Set::Scalar checksum = 0.0;
+    t = Time(1, [&]() {
+            const Set::Scalar *DX = geom[0].CellSize();
+            const Set::Scalar *LO = geom[0].ProbLo();
+            for (amrex::MFIter mfi(*eta[0], false); mfi.isValid(); ++mfi)
+                amrex::LoopOnCpu(mfi.validbox(), [&](int i, int j, int k) {
+                        Set::Vector x;
+                        AMREX_D_TERM(x(0) = LO[0] + ((Set::Scalar)i + 0.5)*DX[0];,
+                                     x(1) = LO[1] + ((Set::Scalar)j + 0.5)*DX[1];,
+                                     x(2) = LO[2] + ((Set::Scalar)k + 0.5)*DX[2];);
+                        checksum += ic->NearestBruteForce(x);
+                    });
+        });
+    RecordItems("voronoi.bruteforce", name, cells, t, records);
+
+    amrex::ParallelDescriptor::ReduceRealSum(checksum);
+    Set::Scalar sum = eta[0]->sum(0);
+    if (std::fabs(sum - checksum) > 1E-8*std::fabs(checksum))
+        Util::Warning(INFO,"Voronoi bucket and brute-force grain ids differ: ",sum," vs ",checksum);
+}
+
+/// Time Gradient, Hessian and Laplacian of a random cell field, with a
+/// ParallelFor that calls GetStencil at every point and with the
+/// interior/boundary split of Numeric::ParallelForStencil
+void Stencil(const Options &opt, std::vector<Record> &records)
+{
+    BL_PROFILE("Bench::Stencil");
+    const int n_cell = opt.stencil_n_cell;
+    amrex::Box domain(amrex::IntVect::TheZeroVector(), amrex::IntVect(n_cell-1));
+    amrex::Geometry geom(domain);
+    amrex::BoxArray grids(domain);
+    grids.maxSize(n_cell/2);
+    amrex::DistributionMapping dmap(grids);
+    amrex::MultiFab phi(grids,dmap,1,1), out(grids,dmap,AMREX_SPACEDIM*AMREX_SPACEDIM,0);
+    for (amrex::MFIter mfi(phi, false); mfi.isValid(); ++mfi)
+    {
+        amrex::Array4<Set::Scalar> const &f = phi.array(mfi);
+        amrex::LoopOnCpu(mfi.growntilebox(), [&](int i, int j, int k) {f(i,j,k) = Util::Random();});
+    }
+    const Set::Scalar *DX = geom.CellSize();
+    const long cells = grids.numPts();
+
+    auto timeit = [&](std::string kernel, std::string name, auto &&kernel_fn) {
+        Set::Scalar t = Time(opt.repeat, [&]() {
+                for (amrex::MFIter mfi(out,amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+                    kernel_fn(mfi.tilebox(), phi.const_array(mfi), out.array(mfi));
+                amrex::Gpu::streamSynchronize();
+            });
+        RecordItems(kernel, name, cells, t, records);
+    };
+
+    // Gradient: one-sided stencils on the boundary slabs
+    timeit("stencil.runtime", "gradient", [&](const amrex::Box &bx, amrex::Array4<const Set::Scalar> const &f, amrex::Array4<Set::Scalar> const &o) {
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                Set::Vector grad = Numeric::Gradient(f,i,j,k,0,DX,Numeric::GetStencil(i,j,k,domain));
+                for (int d = 0; d < AMREX_SPACEDIM; d++) o(i,j,k,d) = grad(d);
+            });
+        });
+    timeit("stencil.split", "gradient", [&](const amrex::Box &bx, amrex::Array4<const Set::Scalar> const &f, amrex::Array4<Set::Scalar> const &o) {
+            Numeric::ParallelForStencil(bx, domain, [=] AMREX_GPU_DEVICE(int i, int j, int k, auto sten) {
+                Set::Vector grad = Numeric::Gradient(f,i,j,k,0,DX,sten);
+                for (int d = 0; d < AMREX_SPACEDIM; d++) o(i,j,k,d) = grad(d);
+            });
+        });
+
+    // Hessian: central everywhere, so only the loop structure differs
+    timeit("stencil.runtime", "hessian", [&](const amrex::Box &bx, amrex::Array4<const Set::Scalar> const &f, amrex::Array4<Set::Scalar> const &o) {
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                Set::Matrix hess = Numeric::Hessian(f,i,j,k,0,DX);
+                for (int d = 0; d < AMREX_SPACEDIM*AMREX_SPACEDIM; d++) o(i,j,k,d) = hess.data()[d];
+            });
+        });
+    timeit("stencil.split", "hessian", [&](const amrex::Box &bx, amrex::Array4<const Set::Scalar> const &f, amrex::Array4<Set::Scalar> const &o) {
+            Numeric::ParallelForStencil(bx, domain, [=] AMREX_GPU_DEVICE(int i, int j, int k, auto) {
+                Set::Matrix hess = Numeric::Hessian(f,i,j,k,0,DX);
+                for (int d = 0; d < AMREX_SPACEDIM*AMREX_SPACEDIM; d++) o(i,j,k,d) = hess.data()[d];
+            });
+        });
+
+    // Laplacian
+    timeit("stencil.runtime", "laplacian", [&](const amrex::Box &bx, amrex::Array4<const Set::Scalar> const &f, amrex::Array4<Set::Scalar> const &o) {
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                o(i,j,k,0) = Numeric::Laplacian(f,i,j,k,0,DX);
+            });
+        });
+    timeit("stencil.split", "laplacian", [&](const amrex::Box &bx, amrex::Array4<const Set::Scalar> const &f, amrex::Array4<Set::Scalar> const &o) {
+            Numeric::ParallelForStencil(bx, domain, [=] AMREX_GPU_DEVICE(int i, int j, int k, auto) {
+                o(i,j,k,0) = Numeric::Laplacian(f,i,j,k,0,DX);
+            });
+        });
+}
+
+/// Time the tensile part of a random symmetric strain field with Eigen, with
+/// the pointwise closed form and with the batched closed form
+void Spectral(const Options &opt, std::vector<Record> &records)
+{
+    BL_PROFILE("Bench::Spectral");
+    amrex::Box bx(amrex::IntVect::TheZeroVector(), amrex::IntVect(63));
+    amrex::FArrayBox eps_fab(bx, AMREX_SPACEDIM*AMREX_SPACEDIM), epsp_fab(bx, AMREX_SPACEDIM*AMREX_SPACEDIM);
+    amrex::Array4<Set::Scalar> const &eps_init = eps_fab.array();
+    amrex::LoopOnCpu(bx, [&](int i, int j, int k) {
+            Set::Matrix A = Set::Matrix::Random();
+            Numeric::MatrixToField(eps_init,i,j,k,0.5*(A + A.transpose()));
+        });
+    amrex::Array4<const Set::Scalar> const &eps = eps_fab.const_array();
+    amrex::Array4<Set::Scalar> const &epsp = epsp_fab.array();
+    const long cells = bx.numPts();
+
+    Set::Scalar t = Time(opt.repeat, [&]() {
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                    Set::Matrix A = Numeric::FieldToMatrix(eps,i,j,k);
+                    Eigen::SelfAdjointEigenSolver<Set::Matrix> eigensolver(A);
+                    Set::Vector eValues = eigensolver.eigenvalues();
+                    Set::Matrix eVectors = eigensolver.eigenvectors();
+                    Set::Matrix Ap = Set::Matrix::Zero();
+                    for (int n = 0; n < AMREX_SPACEDIM; n++)
+                        if (eValues(n) > 0.0) Ap += eValues(n)*(eVectors.col(n)*eVectors.col(n).transpose());
+                    Numeric::MatrixToField(epsp,i,j,k,Ap);
+                });
+        });
+    RecordItems("spectral.eigen", "split", cells, t, records);
+
+    t = Time(opt.repeat, [&]() {
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) {
+                    Set::Matrix Ap, An;
+                    Numeric::SpectralSplit(Numeric::FieldToMatrix(eps,i,j,k), Ap, An);
+                    Numeric::MatrixToField(epsp,i,j,k,Ap);
+                });
+        });
+    RecordItems("spectral.closedform", "split", cells, t, records);
+
+    t = Time(opt.repeat, [&]() { Numeric::SpectralSplit(bx, eps, epsp); });
+    RecordItems("spectral.batched", "split", cells, t, records);
+}
+
+/// Parameters added to the ParmParse table before an integrator is built.
+/// They are added after the command line, so they take precedence.
+using Params = std::vector<std::pair<std::string,std::vector<std::string>>>;
+
+/// Build an INTEGRATOR from the parameters and time InitData and Evolve.
+/// The output directory is only created by Util::Initialize when plot_file
+/// is given on the command line, so it is created here.
+template<class INTEGRATOR>
+Set::Scalar Integrate(const Params &params)
+{
+    BL_PROFILE("Bench::Integrate");
+    amrex::ParmParse pp;
+    for (auto &p : params) pp.addarr(p.first.c_str(), p.second);
+    std::string plot_file = Util::GetFileName();
+    if (amrex::ParallelDescriptor::IOProcessor() && !amrex::UtilCreateDirectory(plot_file, 0755))
+        Util::Abort(INFO,"Could not create ",plot_file);
+    amrex::ParallelDescriptor::Barrier();
+    // The destructor is timed too: it waits for asynchronous plotfiles
+    std::unique_ptr<INTEGRATOR> integrator(new INTEGRATOR());
+    return Time(1, [&]() {
+            integrator->InitData();
+            integrator->Evolve();
+            integrator.reset();
+        });
+}
+
+/// Parameters for a short PhaseFieldMicrostructure run with Voronoi grains
+/// and no output
+Params MicrostructureParams(int n_cell, int grains, int steps)
+{
+    const std::string n = std::to_string(n_cell);
+    return {
+        {"plot_file",                   {"bench_output"}},
+        {"max_step",                    {std::to_string(steps)}},
+        {"stop_time",                   {"1E10"}},
+        {"timestep",                    {"1E-5"}},
+        {"amr.plot_int",                {"-1"}},
+        {"amr.max_level",               {"0"}},
+        {"amr.n_cell",                  {AMREX_D_DECL(n,n,n)}},
+        {"amr.max_grid_size",           {"32"}},
+        {"amr.blocking_factor",         {"4"}},
+        {"ic.type",                     {"voronoi"}},
+        {"ic.voronoi.number_of_grains", {std::to_string(grains)}},
+        {"pf.number_of_grains",         {std::to_string(grains)}},
+        {"pf.M",                        {"1.0"}},
+        {"pf.mu",                       {"10.0"}},
+        {"pf.gamma",                    {"1.0"}},
+        {"pf.l_gb",                     {"0.02"}},
+        {"pf.sigma0",                   {"0.075"}},
+        {"pf.sparse.on",                {"0"}},
+        {"bc.eta.type.xlo",             {"neumann"}},
+        {"bc.eta.type.xhi",             {"neumann"}},
+        {"bc.eta.type.ylo",             {"neumann"}},
+        {"bc.eta.type.yhi",             {"neumann"}},
+        {"bc.eta.type.zlo",             {"neumann"}},
+        {"bc.eta.type.zhi",             {"neumann"}}};
+}
+
+/// Time a few steps of PhaseFieldMicrostructure with a large number of
+/// grains, with dense and with sparse grain storage
+void Microstructure(const Options &opt, std::vector<Record> &records)
+{
+    BL_PROFILE("Bench::Microstructure");
+    const long updates = (long)AMREX_D_TERM(opt.microstructure_n_cell,*opt.microstructure_n_cell,*opt.microstructure_n_cell)
+                         * opt.microstructure_steps;
+    const std::string name = std::to_string(opt.microstructure_grains) + ".grains";
+
+    for (std::string mode : {"dense","sparse"})
+    {
+        Params run = MicrostructureParams(opt.microstructure_n_cell, opt.microstructure_grains, opt.microstructure_steps);
+        run.push_back({"pf.sparse.on",  {mode == "sparse" ? "1" : "0"}});
+        Set::Scalar t = Integrate<Integrator::PhaseFieldMicrostructure>(run);
+        RecordItems("microstructure." + mode, name, updates, t, records);
+    }
+}
+
+/// Time a short PhaseFieldMicrostructure run that writes a plotfile every
+/// step, with synchronous and with asynchronous output
+void Plotfile(const Options &opt, std::vector<Record> &records)
+{
+    BL_PROFILE("Bench::Plotfile");
+    const long updates = (long)AMREX_D_TERM(opt.plotfile_n_cell,*opt.plotfile_n_cell,*opt.plotfile_n_cell)
+                         * opt.plotfile_steps;
+
+    for (std::string mode : {"sync","async"})
+    {
+        if (mode == "async" && !amrex::AsyncOut::UseAsyncOut())
+        {
+            Util::Warning(INFO,"plotfile.async requires amrex.async_out=1 on the command line; skipping");
+            continue;
+        }
+        Params run = MicrostructureParams(opt.plotfile_n_cell, 20, opt.plotfile_steps);
+        run.push_back({"amr.plot_int",   {"1"}});
+        run.push_back({"amr.plot_async", {mode == "async" ? "1" : "0"}});
+        Set::Scalar t = Integrate<Integrator::PhaseFieldMicrostructure>(run);
+        RecordItems("plotfile." + mode, "20.grains", updates, t, records);
+    }
+}
+
+void Write(std::ostream &out, const std::vector<Record> &records)
+{
+    out << "[" << std::endl;
+    for (unsigned int i = 0; i < records.size(); i++)
+    {
+        const Record &r = records[i];
+        out << "  {\"kernel\": \"" << r.kernel << "\", "
+            << "\"model\": \"" << r.model << "\", "
+            << "\"dim\": " << AMREX_SPACEDIM << ", "
+            << "\"nprocs\": " << amrex::ParallelDescriptor::NProcs() << ", "
+            << "\"levels\": " << r.levels << ", "
+            << "\"box_size\": " << r.box_size << ", "
+            << "\"nodes\": " << r.nodes << ", "
+            << std::setprecision(6)
+            << "\"ns_per_node\": " << r.ns_per_node << ", "
+            << "\"gflops\": " << r.gflops << ", "
+            << "\"gbytes_per_s\": " << r.gbytes_per_s << "}"
+            << (i+1 < records.size() ? "," : "") << std::endl;
+    }
+    out << "]" << std::endl;
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+    Util::Initialize(argc, argv);
+    Util::Seed(2);
+
+    amrex::RealBox rb({AMREX_D_DECL(0.,0.,0.)}, {AMREX_D_DECL(1.,1.,1.)});
+    amrex::Geometry::Setup(&rb, 0);
+
+    Bench::Options opt;
+    opt.box_sizes = {8,16,32};
+    std::vector<std::string> models = {"linear.isotropic","linear.cubic","affine.j2"};
+    #if AMREX_SPACEDIM == 3
+    models.push_back("elastic.neohookean");
+    #endif
+    std::vector<std::string> suites = {"operator","contraction","psread","voronoi","stencil","spectral","microstructure","plotfile"};
+    std::string output = "bench.json";
+    {
+        IO::ParmParse pp("bench");
+        pp.query("n_cell",opt.n_cell);           // coarse level cells per direction
+        pp.queryarr("box_sizes",opt.box_sizes);  // max grid sizes to sweep
+        pp.queryarr("levels",opt.levels);        // numbers of AMR levels to sweep
+        pp.query("repeat",opt.repeat);           // repetitions per kernel
+        pp.query("nmaterials",opt.nmaterials);   // distinct random moduli per grid
+        pp.queryarr("models",models);            // models to sweep
+        pp.query("contractions",opt.contractions); // Matrix4 contractions per symmetry
+        pp.query("psread.spheres",opt.psread_spheres); // spheres in the PSRead pack
+        pp.query("psread.n_cell",opt.psread_n_cell);   // cells per direction for the PSRead pack
+        pp.query("stencil.n_cell",opt.stencil_n_cell); // cells per direction for the stencils
+        pp.query("voronoi.grains",opt.voronoi_grains);   // seeds in the Voronoi tessellation
+        pp.query("voronoi.n_cell",opt.voronoi_n_cell);   // cells per direction for the Voronoi tessellation
+        pp.query("microstructure.grains",opt.microstructure_grains); // grains in the microstructure runs
+        pp.query("microstructure.n_cell",opt.microstructure_n_cell); // cells per direction for the microstructure runs
+        pp.query("microstructure.steps",opt.microstructure_steps);   // timesteps per microstructure run
+        pp.query("plotfile.n_cell",opt.plotfile_n_cell); // cells per direction for the plotfile runs
+        pp.query("plotfile.steps",opt.plotfile_steps);   // timesteps (and plotfiles) per plotfile run
+        pp.queryarr("suites",suites);            // benchmark suites to run
+        pp.query("output",output);               // JSON output file, or - for stdout (bench.json)
+    }
+
+    std::vector<Bench::Record> records;
+    for (auto suite : suites)
+    {
+        if (suite == "operator")
+        {
+            for (auto model : models)
+                for (int nlevels : opt.levels)
+                    for (int box_size : opt.box_sizes)
+                    {
+                        Util::Message(INFO,model,": ",nlevels," level(s), box size ",box_size);
+                        if      (model == "linear.isotropic")
+                            Bench::Run<Model::Solid::Linear::Isotropic>(model,opt,nlevels,box_size,records);
+                        else if (model == "linear.cubic")
+                            Bench::Run<Model::Solid::Linear::Cubic>(model,opt,nlevels,box_size,records);
+                        else if (model == "affine.j2")
+                            Bench::Run<Model::Solid::Affine::J2>(model,opt,nlevels,box_size,records);
+                        #if AMREX_SPACEDIM == 3
+                        else if (model == "elastic.neohookean")
+                            Bench::Run<Model::Solid::Elastic::NeoHookean>(model,opt,nlevels,box_size,records);
+                        #endif
+                        else Util::Abort(INFO,"Invalid model ",model);
+                    }
+        }
+        else if (suite == "contraction")
+        {
+            Util::Message(INFO,"Matrix4 contractions");
+            Bench::Contraction<Set::Sym::Major>("major",opt,records);
+            Bench::Contraction<Set::Sym::MajorMinor>("majorminor",opt,records);
+            Bench::Contraction<Set::Sym::Diagonal>("diagonal",opt,records);
+            Bench::Contraction<Set::Sym::Full>("full",opt,records);
+            Bench::Contraction<Set::Sym::Isotropic>("isotropic",opt,records);
+        }
+        else if (suite == "psread")
+        {
+            Util::Message(INFO,"IC::PSRead, ",opt.psread_spheres," spheres");
+            Bench::PSRead(opt,records);
+        }
+        else if (suite == "voronoi")
+        {
+            Util::Message(INFO,"IC::Voronoi, ",opt.voronoi_grains," grains");
+            Bench::Voronoi(opt,records);
+        }
+        else if (suite == "stencil")
+        {
+            Util::Message(INFO,"Numeric::Stencil, ",opt.stencil_n_cell," cells per direction");
+            Bench::Stencil(opt,records);
+        }
+        else if (suite == "spectral")
+        {
+            Util::Message(INFO,"Numeric::SpectralSplit");
+            Bench::Spectral(opt,records);
+        }
+        else if (suite == "microstructure")
+        {
+            Util::Message(INFO,"PhaseFieldMicrostructure, ",opt.microstructure_grains," grains");
+            Bench::Microstructure(opt,records);
+        }
+        else if (suite == "plotfile")
+        {
+            Util::Message(INFO,"Plotfile output, synchronous and asynchronous");
+            Bench::Plotfile(opt,records);
+        }
+        else Util::Abort(INFO,"Invalid suite ",suite);
+    }
+
+    if (amrex::ParallelDescriptor::IOProcessor())
+    {
+        if (output == "-") Bench::Write(std::cout, records);
+        else
+        {
+            std::ofstream file(output);
+            if (!file) Util::Abort(INFO,"Could not open ",output);
+            Bench::Write(file, records);
+            Util::Message(INFO,"Wrote ",records.size()," records to ",output);
+        }
+    }
+
+    Util::Finalize();
+}
@@ -3,7 +3,13 @@
 #include "Util/Util.H"
 
 #include "Test/Numeric/Stencil.H"
+#include "Test/Numeric/CellLinear.H"
+#include "Test/Numeric/Spectral.H"
 #include "Test/Set/Matrix4.H"
+#include "Test/Operator/Elastic.H"
+#include "Test/IC/Voronoi.H"
+#include "Test/IC/PSRead.H"
+#include "Test/Model/Interface/GB/Tabulated.H"
 
 #include "Operator/Elastic.H"
 
@@ -16,6 +22,9 @@
 #include "Model/Solid/Affine/Isotropic.H"
 #include "Model/Solid/Affine/Cubic.H"
 #include "Model/Solid/Elastic/NeoHookean.H"
+#include "Model/Interface/GB/Sin.H"
+#include "Model/Interface/GB/AbsSin.H"
+#include "Model/Interface/GB/Read.H"
 
 int main (int argc, char* argv[])
 {
@@ -51,6 +60,22 @@ int main (int argc, char* argv[])
         subfailed += Util::Test::SubMessage("3D - MajorMinor", test_3d_majorminor.SymmetryTest(0));
     }
 
+    Util::Test::Message("Set::Matrix4 contractions");
+    {
+        int subfailed = 0;
+        Test::Set::Matrix4<AMREX_SPACEDIM,Set::Sym::Major> test_major;
+        Test::Set::Matrix4<AMREX_SPACEDIM,Set::Sym::MajorMinor> test_majorminor;
+        Test::Set::Matrix4<AMREX_SPACEDIM,Set::Sym::Diagonal> test_diagonal;
+        Test::Set::Matrix4<AMREX_SPACEDIM,Set::Sym::Full> test_full;
+        Test::Set::Matrix4<AMREX_SPACEDIM,Set::Sym::Isotropic> test_isotropic;
+        subfailed += Util::Test::SubMessage("Major",      test_major.ContractionTest(0));
+        subfailed += Util::Test::SubMessage("MajorMinor", test_majorminor.ContractionTest(0));
+        subfailed += Util::Test::SubMessage("Diagonal",   test_diagonal.ContractionTest(0));
+        subfailed += Util::Test::SubMessage("Full",       test_full.ContractionTest(0));
+        subfailed += Util::Test::SubMessage("Isotropic",  test_isotropic.ContractionTest(0));
+        failed += Util::Test::SubFinalMessage(subfailed);
+    }
+
     Util::Test::Message("Numeric::Interpolator<Linear>");
     {
         int subfailed = 0;
@@ -59,6 +84,26 @@ int main (int argc, char* argv[])
         failed += Util::Test::SubFinalMessage(subfailed);
     }
 
+    Util::Test::Message("Numeric::Interpolator::CellLinear");
+    {
+        int subfailed = 0;
+        Test::Numeric::CellLinear test;
+        subfailed += Util::Test::SubMessage("Conservation (ratio 2)",test.Conservation(0,2));
+        subfailed += Util::Test::SubMessage("Conservation (ratio 4)",test.Conservation(0,4));
+        subfailed += Util::Test::SubMessage("Sparse vector conservation (ratio 2)",test.SparseConservation(0,2));
+        failed += Util::Test::SubFinalMessage(subfailed);
+    }
+
+    Util::Test::Message("Numeric::Spectral");
+    {
+        int subfailed = 0;
+        Test::Numeric::Spectral test;
+        subfailed += Util::Test::SubMessage("Random matrices",test.Random(0,10000));
+        subfailed += Util::Test::SubMessage("Near-degenerate matrices",test.NearDegenerate(0));
+        subfailed += Util::Test::SubMessage("Batched split",test.Batch(0));
+        failed += Util::Test::SubFinalMessage(subfailed);
+    }
+
     Util::Test::Message("Numeric::Stencil test");
     {
         int subfailed = 0;
@@ -97,6 +142,56 @@ int main (int argc, char* argv[])
         subfailed += Util::Test::SubMessage("1-2-1",test.Derivative<1,2,1>(0));
         subfailed += Util::Test::SubMessage("1-1-2",test.Derivative<1,1,2>(0));
 #endif
+        subfailed += Util::Test::SubMessage("2nd order boundary stencils",test.BoundaryAccuracy(0));
+        subfailed += Util::Test::SubMessage("Runtime vs split stencils",test.SplitMatch(0));
+        failed += Util::Test::SubFinalMessage(subfailed);
+    }
+
+    Util::Test::Message("Operator::Elastic");
+    {
+        int subfailed = 0;
+        Test::Operator::Elastic test;
+        test.Define(16);
+        subfailed += Util::Test::SubMessage("Diagonal vs probe",test.DiagonalTest(0));
+        subfailed += Util::Test::SubMessage("Material table model",test.MaterialTableTest(0));
+        subfailed += Util::Test::SubMessage("Material table footprint",test.FootprintTest(0));
+        subfailed += Util::Test::SubMessage("Descriptor boundary conditions",test.BoundaryTest(0));
+        failed += Util::Test::SubFinalMessage(subfailed);
+    }
+
+    Util::Test::Message("IC::Voronoi");
+    {
+        int subfailed = 0;
+        Test::IC::Voronoi test;
+        test.Define(32,false);
+        subfailed += Util::Test::SubMessage("Bucket grid - nonperiodic",test.Match(0,100));
+        test.Define(32,true);
+        subfailed += Util::Test::SubMessage("Bucket grid - periodic",test.Match(0,100));
+        failed += Util::Test::SubFinalMessage(subfailed);
+    }
+
+    Util::Test::Message("IC::PSRead");
+    {
+        int subfailed = 0;
+        Test::IC::PSRead test;
+        test.Define(64,false);
+        subfailed += Util::Test::SubMessage("Spatial hash - nonperiodic",test.Match(0,200));
+        subfailed += Util::Test::SubMessage("Binary cache",test.Cache(0));
+        test.Define(64,true);
+        subfailed += Util::Test::SubMessage("Spatial hash - periodic",test.Match(0,200));
+        failed += Util::Test::SubFinalMessage(subfailed);
+    }
+
+    Util::Test::Message("Model::Interface::GB::Tabulated");
+    {
+        int subfailed = 0;
+        Test::Model::Interface::GB::Tabulated test;
+        subfailed += Util::Test::SubMessage("Sin",test.Tabulate<Model::Interface::GB::Sin>(0,1E-6));
+        subfailed += Util::Test::SubMessage("AbsSin",test.Tabulate<Model::Interface::GB::AbsSin>(0,1E-6));
+        subfailed += Util::Test::SubMessage("Read",test.Tabulate<Model::Interface::GB::Read>(0,1E-6));
+        #if AMREX_SPACEDIM == 3
+        subfailed += Util::Test::SubMessage("SH",test.TabulateSH(0,1E-3));
+        #endif
         failed += Util::Test::SubFinalMessage(subfailed);
     }
 